@@ -1,7 +1,12 @@
 import netsnmp
 from .netsnmptable import (
-    create_from_mib, str_to_fixlen_iid, str_to_varlen_iid, Table
+    create_from_mib, create_from_schema, create_from_schema_file, create_group, str_to_fixlen_iid, str_to_varlen_iid,
+    split_int_index, Table, TableGroup, Poller, Column, Condition
 )
+from .interface import ColumnArray
 
 # monkey patching netsnmp
 netsnmp.Session.table_from_mib = netsnmptable.create_from_mib
+netsnmp.Session.table_from_schema = netsnmptable.create_from_schema
+netsnmp.Session.table_from_schema_file = netsnmptable.create_from_schema_file
+netsnmp.Session.table_group = netsnmptable.create_group
@@ -0,0 +1,227 @@
+/*
+ * Response capture and replay.
+ *
+ * The responses of a walk are recorded to a binary blob, and handed back to the same walk later
+ * instead of sending requests. This makes the decode path measurable without network jitter,
+ * and lets captures of problematic agents be shared. See capture.h for the format.
+ */
+
+#include <Python.h>
+#include <arpa/inet.h>
+#include "capture.h"
+
+static void put_value(byte_buf_t* buf, netsnmp_variable_list* vars) {
+    size_t i, nr_of_subids;
+
+    switch (vars->type) {
+    case ASN_INTEGER:
+    case ASN_COUNTER:
+    case ASN_GAUGE:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+        __buf_put_u32(buf, sizeof(uint32_t));
+        __buf_put_u32(buf, (uint32_t) *vars->val.integer);
+        break;
+    case ASN_COUNTER64:
+        __buf_put_u32(buf, 2 * sizeof(uint32_t));
+        __buf_put_u32(buf, (uint32_t) vars->val.counter64->high);
+        __buf_put_u32(buf, (uint32_t) vars->val.counter64->low);
+        break;
+    case ASN_OBJECT_ID:
+        nr_of_subids = vars->val_len / sizeof(oid);
+        __buf_put_u32(buf, (uint32_t) (nr_of_subids * sizeof(uint32_t)));
+        for (i = 0; i < nr_of_subids; i++)
+            __buf_put_u32(buf, (uint32_t) vars->val.objid[i]);
+        break;
+    case ASN_NULL:
+    case SNMP_ENDOFMIBVIEW:
+    case SNMP_NOSUCHOBJECT:
+    case SNMP_NOSUCHINSTANCE:
+        __buf_put_u32(buf, 0);
+        break;
+    default:
+        __buf_put_u32(buf, (uint32_t) vars->val_len);
+        __buf_put_bytes(buf, vars->val.string, vars->val_len);
+        break;
+    }
+}
+
+static uint32_t load_u32(const char* bytes) {
+    uint32_t val;
+
+    memcpy(&val, bytes, sizeof(val));
+    return ntohl(val);
+}
+
+/*
+ * Read one response. Varbinds are added to pdu, or only checked if pdu is NULL.
+ * Returns -1 if the data is corrupt or out of memory.
+ */
+static int get_response(byte_reader_t* rd, netsnmp_pdu* pdu) {
+    oid name[MAX_OID_LEN];
+    oid objid[MAX_OID_LEN];
+    size_t name_len;
+    struct counter64 c64;
+    const char* bytes;
+    uint32_t errstat, errindex, nr_of_vars, type, val_len, i, j;
+    long val;
+    const void* value;
+    size_t value_len;
+
+    errstat = __buf_get_u32(rd);
+    errindex = __buf_get_u32(rd);
+    nr_of_vars = __buf_get_u32(rd);
+    if (pdu) {
+        pdu->errstat = errstat;
+        pdu->errindex = errindex;
+    }
+
+    for (i = 0; i < nr_of_vars && !rd->failed; i++) {
+        name_len = __buf_get_oid(rd, name);
+        type = __buf_get_u32(rd);
+        val_len = __buf_get_u32(rd);
+        bytes = __buf_get_bytes(rd, val_len);
+        if (!bytes || name_len == 0)
+            return -1;
+
+        switch (type) {
+        case ASN_INTEGER:
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+        case ASN_UINTEGER:
+            if (val_len != sizeof(uint32_t))
+                return -1;
+            if (type == ASN_INTEGER)
+                val = (int32_t) load_u32(bytes);
+            else
+                val = load_u32(bytes);
+            value = &val;
+            value_len = sizeof(val);
+            break;
+        case ASN_COUNTER64:
+            if (val_len != 2 * sizeof(uint32_t))
+                return -1;
+            c64.high = load_u32(bytes);
+            c64.low = load_u32(bytes + sizeof(uint32_t));
+            value = &c64;
+            value_len = sizeof(c64);
+            break;
+        case ASN_OBJECT_ID:
+            if (val_len % sizeof(uint32_t) || val_len / sizeof(uint32_t) > MAX_OID_LEN)
+                return -1;
+            for (j = 0; j < val_len / sizeof(uint32_t); j++)
+                objid[j] = load_u32(bytes + j * sizeof(uint32_t));
+            value = objid;
+            value_len = j * sizeof(oid);
+            break;
+        case ASN_NULL:
+        case SNMP_ENDOFMIBVIEW:
+        case SNMP_NOSUCHOBJECT:
+        case SNMP_NOSUCHINSTANCE:
+            if (val_len != 0)
+                return -1;
+            value = NULL;
+            value_len = 0;
+            break;
+        default:
+            if (type > 0xff)
+                return -1;
+            value = bytes;
+            value_len = val_len;
+            break;
+        }
+
+        if (pdu && !snmp_pdu_add_variable(pdu, name, name_len, (u_char) type, value, value_len))
+            return -1;
+    }
+    return rd->failed ? -1 : 0;
+}
+
+void capture_init_record(capture_t* capture) {
+    memset(capture, 0, sizeof(capture_t));
+    __buf_put_bytes(&capture->record, CAPTURE_MAGIC, 4);
+    __buf_put_u32(&capture->record, CAPTURE_VERSION);
+}
+
+/*
+ * Prepare replay of data written by capture_result. data must stay valid until the fetch ends.
+ * Returns -1 with exception set if data is not a valid capture.
+ */
+int capture_init_replay(capture_t* capture, const char* data, size_t len) {
+    byte_reader_t rd = { data, len, 0, 0 };
+    const char* magic;
+
+    memset(capture, 0, sizeof(capture_t));
+    magic = __buf_get_bytes(&rd, 4);
+    if (!magic || memcmp(magic, CAPTURE_MAGIC, 4) != 0) {
+        PyErr_SetString(PyExc_ValueError, "not a response capture");
+        return -1;
+    }
+    if (__buf_get_u32(&rd) != CAPTURE_VERSION) {
+        PyErr_SetString(PyExc_ValueError, "unsupported response capture version");
+        return -1;
+    }
+    capture->replaying = 1;
+    capture->replay = rd;
+
+    /* check everything now, so capture_next fails only at the end */
+    while (rd.pos < rd.len) {
+        if (get_response(&rd, NULL) < 0) {
+            PyErr_SetString(PyExc_ValueError, "corrupt response capture");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* Append a response. Doesn't need the GIL. */
+void capture_record(capture_t* capture, netsnmp_pdu* response) {
+    netsnmp_variable_list* vars;
+    uint32_t nr_of_vars = 0;
+
+    for (vars = response->variables; vars; vars = vars->next_variable)
+        nr_of_vars++;
+    __buf_put_u32(&capture->record, (uint32_t) response->errstat);
+    __buf_put_u32(&capture->record, (uint32_t) response->errindex);
+    __buf_put_u32(&capture->record, nr_of_vars);
+    for (vars = response->variables; vars; vars = vars->next_variable) {
+        __buf_put_oid(&capture->record, vars->name, vars->name_length);
+        __buf_put_u32(&capture->record, vars->type);
+        put_value(&capture->record, vars);
+    }
+}
+
+/*
+ * Build the next replayed response. Doesn't need the GIL.
+ * Returns NULL at the end of the capture, or if out of memory.
+ */
+netsnmp_pdu* capture_next(capture_t* capture) {
+    netsnmp_pdu* response;
+
+    if (capture->replay.pos >= capture->replay.len)
+        return NULL;
+    response = snmp_pdu_create(SNMP_MSG_RESPONSE);
+    if (!response)
+        return NULL;
+    if (get_response(&capture->replay, response) < 0) {
+        snmp_free_pdu(response);
+        return NULL;
+    }
+    return response;
+}
+
+/*
+ * Return value: New reference to a string with the recorded responses,
+ * NULL with exception set on error.
+ */
+PyObject* capture_result(capture_t* capture) {
+    if (capture->record.failed)
+        return PyErr_NoMemory();
+    return PyString_FromStringAndSize(capture->record.data, capture->record.len);
+}
+
+void capture_release(capture_t* capture) {
+    free(capture->record.data);
+    memset(capture, 0, sizeof(capture_t));
+}
@@ -0,0 +1,33 @@
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <Python.h>
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include "util.h"
+
+/*
+ * Binary capture of the responses of a walk, in the order they arrived:
+ * per response error status, error index, number of varbinds, and per varbind OID, ASN type,
+ * value length in bytes and value. All integers are 32 bit in network byte order.
+ * Integer values are one integer, COUNTER64 values high and low integer, OBJECT IDENTIFIER values
+ * their subids, NULL and exceptions empty, all other values the raw octets.
+ */
+#define CAPTURE_MAGIC "NSTC"
+#define CAPTURE_VERSION 1
+
+/* recording or replay state of one fetch */
+typedef struct capture_s {
+    int replaying;        // responses are taken from replay instead of the network
+    byte_buf_t record;    // responses received so far, when recording
+    byte_reader_t replay; // remaining responses, when replaying
+} capture_t;
+
+extern void capture_init_record(capture_t* capture);
+extern int capture_init_replay(capture_t* capture, const char* data, size_t len);
+extern void capture_record(capture_t* capture, netsnmp_pdu* response);
+extern netsnmp_pdu* capture_next(capture_t* capture);
+extern PyObject* capture_result(capture_t* capture);
+extern void capture_release(capture_t* capture);
+
+#endif /* CAPTURE_H_ */
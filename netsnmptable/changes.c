@@ -0,0 +1,266 @@
+/*
+ * Change detection between walks.
+ *
+ * Cells are collected like for the columnar layout, and each row gets a hash of its cells.
+ * When the walk has ended, row hashes are compared with the snapshot of the previous walk,
+ * and python objects are created for added and changed rows only. Unchanged rows cost
+ * a hash lookup, whatever the size of the table.
+ */
+
+#include <Python.h>
+#include "changes.h"
+#include "columnar.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t fnv_add(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*) data;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/* spread the bits, so sums of cell hashes don't cancel out in patterns */
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+ * Hash of one cell, from column number, ASN type and raw value. Doesn't need the GIL.
+ */
+uint64_t changes_cell_hash(int col, netsnmp_variable_list* vars) {
+    uint64_t hash = FNV_OFFSET;
+    uint64_t value;
+    uint32_t type = vars->type;
+
+    hash = fnv_add(hash, &col, sizeof(col));
+    hash = fnv_add(hash, &type, sizeof(type));
+    switch (vars->type) {
+    case ASN_INTEGER:
+    case ASN_COUNTER:
+    case ASN_GAUGE:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+        value = (uint64_t) *vars->val.integer;
+        hash = fnv_add(hash, &value, sizeof(value));
+        break;
+    case ASN_COUNTER64:
+        value = ((uint64_t) (vars->val.counter64->high & 0xffffffffUL) << 32)
+                | (vars->val.counter64->low & 0xffffffffUL);
+        hash = fnv_add(hash, &value, sizeof(value));
+        break;
+    case ASN_NULL:
+    case SNMP_ENDOFMIBVIEW:
+    case SNMP_NOSUCHOBJECT:
+    case SNMP_NOSUCHINSTANCE:
+        break;
+    default:
+        if (vars->val.string)
+            hash = fnv_add(hash, vars->val.string, vars->val_len);
+        break;
+    }
+    return mix(hash);
+}
+
+/*
+ * Create the native value of a collected cell, as create_native_value would from the varbind.
+ *
+ * Return value: New reference, NULL with exception set on error.
+ */
+static PyObject* cell_value(columnar_column_t* column, columnar_cell_t* cell) {
+    PyObject* py_value;
+    PyObject* py_subid;
+    uint64_t* subids;
+    size_t i;
+
+    switch (column->kind) {
+    case COLUMN_KIND_INT64:
+        return PyInt_FromLong((long) (int64_t) cell->value);
+    case COLUMN_KIND_UINT64:
+        if (cell->value <= (uint64_t) LONG_MAX)
+            return PyInt_FromLong((long) cell->value);
+        return PyLong_FromUnsignedLongLong((unsigned PY_LONG_LONG) cell->value);
+    case COLUMN_KIND_BYTES:
+        return PyString_FromStringAndSize(column->blob.data + cell->value, cell->len);
+    case COLUMN_KIND_OID:
+        subids = (uint64_t*) column->blob.data + cell->value;
+        py_value = PyTuple_New(cell->len);
+        for (i = 0; py_value && i < cell->len; i++) {
+            py_subid = PyInt_FromSize_t((size_t) subids[i]);
+            if (!py_subid) {
+                Py_CLEAR(py_value);
+                break;
+            }
+            PyTuple_SET_ITEM(py_value, i, py_subid);  // steals reference to py_subid
+        }
+        return py_value;
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+/*
+ * Return value: New reference to the index tuple of an instance OID suffix, NULL with exception set.
+ */
+static PyObject* index_tuple(table_info_t* table_info, oid* suffix, size_t suffix_len) {
+    PyObject* py_index = create_index_tuple(suffix, (int) suffix_len, table_info->index_vars,
+            table_info->index_vars_nrof);
+
+    if (!py_index && !PyErr_Occurred())
+        PyErr_SetString(PyExc_RuntimeError, "instance OID doesn't match the table indexes");
+    return py_index;
+}
+
+static int snapshot_seen(oid_map_entry_t* entry, void* ctx) {
+    return ((snapshot_t*) entry->data)->generation == *(unsigned long*) ctx;
+}
+
+/*
+ * Store the row hashes of a walk into the snapshot, and drop the rows the walk didn't see.
+ * If out of memory, the snapshot is cleared rather than left half updated,
+ * so the next walk reports all rows as added instead of missing changes.
+ * Returns -1 if out of memory.
+ */
+static int update_snapshot(table_info_t* table_info) {
+    oid_map_t* row_cache = &table_info->row_cache;
+    oid_map_t* snapshot = &table_info->snapshot;
+    unsigned long generation = ++table_info->snapshot_generation;
+    oid_map_entry_t* entry;
+    oid_map_entry_t* state;
+    size_t i;
+    int created;
+
+    for (i = 0; i < row_cache->size; i++) {
+        entry = &row_cache->slots[i];
+        if (!entry->key)
+            continue;
+        state = oid_map_insert(snapshot, entry->key, entry->key_len, &created);
+        if (!state)
+            goto fail;
+        ((snapshot_t*) state->data)->generation = generation;
+        ((snapshot_t*) state->data)->hash = ((row_t*) entry->data)->hash;
+    }
+    if (oid_map_retain(snapshot, snapshot_seen, &generation, NULL) < 0)
+        goto fail;
+    return 0;
+
+    fail:
+    oid_map_clear(snapshot, NULL);
+    return -1;
+}
+
+/*
+ * Compare the rows of a finished walk with the snapshot of the previous one, and update the snapshot.
+ * Rows that are new or have a different hash get a row dictionary with the native values of their
+ * collected cells. Snapshot rows the walk didn't see have been removed. An incomplete walk, e.g. one
+ * that timed out, leaves the snapshot alone, as its rows would all look removed or changed.
+ * The snapshot is only updated once the result is complete, an error while building it leaves
+ * the snapshot alone as well.
+ *
+ * Return value: New reference to a tuple (added, changed, removed) of a dictionary, a dictionary and
+ * a list of index tuples, or to None if the walk was incomplete. NULL with exception set on error.
+ */
+PyObject* changes_result(table_info_t* table_info, int complete) {
+    oid_map_t* row_cache = &table_info->row_cache;
+    oid_map_t* snapshot = &table_info->snapshot;
+    columnar_t* columnar = table_info->columnar;
+    columnar_column_t* column;
+    columnar_cell_t* cell;
+    oid_map_entry_t* entry;
+    oid_map_entry_t* state;
+    row_t** rows_by_nr = NULL;
+    row_t* row;
+    PyObject* py_added = NULL;
+    PyObject* py_changed = NULL;
+    PyObject* py_removed = NULL;
+    PyObject* py_value;
+    PyObject* py_result = NULL;
+    size_t i, nr_of_cells;
+    int col;
+
+    if (!complete)
+        return Py_BuildValue("");
+
+    rows_by_nr = calloc(row_cache->used ? row_cache->used : 1, sizeof(row_t*));
+    py_added = PyDict_New();
+    py_changed = PyDict_New();
+    py_removed = PyList_New(0);
+    if (!rows_by_nr) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    if (!py_added || !py_changed || !py_removed)
+        goto done;
+
+    for (i = 0; i < row_cache->size; i++) {
+        entry = &row_cache->slots[i];
+        if (!entry->key)
+            continue;
+        row = (row_t*) entry->data;
+        state = oid_map_find(snapshot, entry->key, entry->key_len);
+        if (state && ((snapshot_t*) state->data)->hash == row->hash)
+            continue;
+
+        /* released with the row cache in table_walk_finish */
+        row->py_index_tuple = index_tuple(table_info, entry->key, entry->key_len);
+        row->py_row_dict = PyDict_New();
+        if (!row->py_index_tuple || !row->py_row_dict
+                || PyDict_SetItem(state ? py_changed : py_added, row->py_index_tuple, row->py_row_dict) < 0)
+            goto done;
+        rows_by_nr[row->nr] = row;
+    }
+
+    /* values of the added and changed rows */
+    for (col = 0; columnar && col < columnar->nr_of_columns; col++) {
+        column = &columnar->column[col];
+        nr_of_cells = column->cells.len / sizeof(columnar_cell_t);
+        for (i = 0; i < nr_of_cells; i++) {
+            cell = &((columnar_cell_t*) column->cells.data)[i];
+            row = rows_by_nr[cell->row_nr];
+            if (!row)
+                continue;
+            py_value = cell_value(column, cell);
+            if (!py_value || PyDict_SetItem(row->py_row_dict,
+                    table_info->column_scheme.column[col].py_label_str, py_value) < 0) {
+                Py_XDECREF(py_value);
+                goto done;
+            }
+            Py_DECREF(py_value);
+        }
+    }
+
+    for (i = 0; i < snapshot->size; i++) {
+        state = &snapshot->slots[i];
+        if (state->key && !oid_map_find(row_cache, state->key, state->key_len)) {
+            PyObject* py_index = index_tuple(table_info, state->key, state->key_len);
+            if (!py_index || PyList_Append(py_removed, py_index) < 0) {
+                Py_XDECREF(py_index);
+                goto done;
+            }
+            Py_DECREF(py_index);
+        }
+    }
+
+    py_result = PyTuple_Pack(3, py_added, py_changed, py_removed);
+    if (py_result && update_snapshot(table_info) < 0) {
+        PyErr_NoMemory();
+        Py_CLEAR(py_result);
+    }
+
+    done:
+    Py_XDECREF(py_added);
+    Py_XDECREF(py_changed);
+    Py_XDECREF(py_removed);
+    free(rows_by_nr);
+    return py_result;
+}
@@ -0,0 +1,18 @@
+#ifndef CHANGES_H_
+#define CHANGES_H_
+
+#include <Python.h>
+#include <stdint.h>
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include "table.h"
+
+/*
+ * Change detection between walks, for LAYOUT_CHANGES.
+ * A row is represented by the sum of the hashes of its cells, so cells may arrive in any order.
+ * The table keeps the row hashes of the previous complete walk in its snapshot.
+ */
+extern uint64_t changes_cell_hash(int col, netsnmp_variable_list* vars);
+extern PyObject* changes_result(table_info_t* table_info, int complete);
+
+#endif /* CHANGES_H_ */
@@ -0,0 +1,514 @@
+/*
+ * Columnar table layout.
+ *
+ * Cells are collected per column into plain C buffers during the walk. When the walk has ended,
+ * rows are sorted by instance OID, and each column is laid out into one contiguous array aligned
+ * to that row order. No python object is created per cell or per row.
+ */
+
+#include <Python.h>
+#include "columnar.h"
+
+static char format_int64[] = "q";
+static char format_uint64[] = "Q";
+static char format_uint8[] = "B";
+
+static int buf_append(columnar_buf_t* buf, const void* data, size_t len) {
+    size_t new_cap;
+    char* new_data;
+
+    if (buf->len + len > buf->cap) {
+        new_cap = buf->cap ? buf->cap : 256;
+        while (new_cap < buf->len + len)
+            new_cap *= 2;
+        new_data = realloc(buf->data, new_cap);
+        if (!new_data)
+            return -1;
+        buf->data = new_data;
+        buf->cap = new_cap;
+    }
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+    return 0;
+}
+
+columnar_t* columnar_allocate(int nr_of_columns) {
+    columnar_t* columnar = calloc(1, sizeof(columnar_t));
+
+    if (!columnar)
+        return NULL;
+    columnar->column = calloc(nr_of_columns > 0 ? nr_of_columns : 1, sizeof(columnar_column_t));
+    if (!columnar->column) {
+        free(columnar);
+        return NULL;
+    }
+    columnar->nr_of_columns = nr_of_columns;
+    return columnar;
+}
+
+void columnar_deallocate(columnar_t* columnar) {
+    int col;
+
+    if (columnar) {
+        for (col = 0; col < columnar->nr_of_columns; col++) {
+            free(columnar->column[col].cells.data);
+            free(columnar->column[col].blob.data);
+        }
+        free(columnar->column);
+        free(columnar);
+    }
+}
+
+static int kind_of(u_char type) {
+    switch (type) {
+    case ASN_INTEGER:
+        return COLUMN_KIND_INT64;
+    case ASN_GAUGE:
+    case ASN_COUNTER:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+    case ASN_COUNTER64:
+        return COLUMN_KIND_UINT64;
+    case ASN_OCTET_STR:
+    case ASN_OPAQUE:
+    case ASN_BIT_STR:
+    case ASN_IPADDRESS:
+        return COLUMN_KIND_BYTES;
+    case ASN_OBJECT_ID:
+        return COLUMN_KIND_OID;
+    default:
+        return COLUMN_KIND_NONE;
+    }
+}
+
+/*
+ * Record the cell of column col in row row_nr.
+ * The first cell of a column determines its kind. Cells of another kind, e.g. exception values,
+ * are left out, so their row shows up as not valid.
+ *
+ * Returns -1 if out of memory.
+ */
+int columnar_store(columnar_t* columnar, int col, size_t row_nr, netsnmp_variable_list *vars) {
+    columnar_column_t* column = &columnar->column[col];
+    columnar_cell_t cell;
+    uint64_t subid;
+    int kind = kind_of(vars->type);
+    size_t i;
+
+    if (kind == COLUMN_KIND_NONE)
+        return 0;
+    if (column->kind == COLUMN_KIND_NONE)
+        column->kind = kind;
+    else if (column->kind != kind)
+        return 0;
+
+    cell.row_nr = row_nr;
+    cell.value = 0;
+    cell.len = 0;
+    switch (kind) {
+    case COLUMN_KIND_INT64:
+        cell.value = (uint64_t) (int64_t) *vars->val.integer;
+        break;
+
+    case COLUMN_KIND_UINT64:
+        if (vars->type == ASN_COUNTER64)
+            cell.value = ((uint64_t) (vars->val.counter64->high & 0xffffffffUL) << 32)
+                    | (vars->val.counter64->low & 0xffffffffUL);
+        else
+            cell.value = (uint64_t) (u_long) *vars->val.integer;
+        break;
+
+    case COLUMN_KIND_BYTES:
+        cell.value = column->blob.len;
+        cell.len = vars->val_len;
+        if (buf_append(&column->blob, vars->val.string, vars->val_len) < 0)
+            return -1;
+        break;
+
+    case COLUMN_KIND_OID:
+        cell.value = column->blob.len / sizeof(uint64_t);
+        cell.len = vars->val_len / sizeof(oid);
+        for (i = 0; i < cell.len; i++) {
+            subid = vars->val.objid[i];
+            if (buf_append(&column->blob, &subid, sizeof(subid)) < 0)
+                return -1;
+        }
+        break;
+    }
+    return buf_append(&column->cells, &cell, sizeof(cell));
+}
+
+/*
+ * ColumnArray type
+ */
+
+static column_array_t* column_array_new(int kind, Py_ssize_t rows, Py_ssize_t nitems) {
+    column_array_t* array = PyObject_New(column_array_t, &ColumnArrayType);
+
+    if (!array)
+        return NULL;
+
+    array->kind = kind;
+    array->rows = rows;
+    array->nitems = nitems;
+    array->offsets = NULL;
+    array->valid = NULL;
+    array->data = NULL;
+    switch (kind) {
+    case COLUMN_KIND_INT64:
+        array->format = format_int64;
+        array->itemsize = sizeof(int64_t);
+        break;
+    case COLUMN_KIND_UINT64:
+    case COLUMN_KIND_OID:
+        array->format = format_uint64;
+        array->itemsize = sizeof(uint64_t);
+        break;
+    default:
+        array->format = format_uint8;
+        array->itemsize = 1;
+        break;
+    }
+    array->data = calloc(nitems > 0 ? nitems : 1, array->itemsize);
+    if (!array->data) {
+        Py_DECREF(array);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    return array;
+}
+
+static void column_array_dealloc(column_array_t* array) {
+    free(array->data);
+    Py_XDECREF(array->offsets);
+    Py_XDECREF(array->valid);
+    PyObject_Del(array);
+}
+
+static Py_ssize_t column_array_length(column_array_t* array) {
+    return array->rows;
+}
+
+/* Value of row i as python object, None if the row has no cell. */
+static PyObject* column_array_item(column_array_t* array, Py_ssize_t i) {
+    int64_t* offsets;
+    PyObject* py_value;
+    PyObject* py_subid;
+    Py_ssize_t j;
+
+    if (i < 0 || i >= array->rows) {
+        PyErr_SetString(PyExc_IndexError, "column array index out of range");
+        return NULL;
+    }
+    if (array->valid && !((unsigned char*) ((column_array_t*) array->valid)->data)[i]) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    switch (array->kind) {
+    case COLUMN_KIND_INT64:
+        return PyInt_FromLong((long) ((int64_t*) array->data)[i]);
+    case COLUMN_KIND_UINT64:
+        return PyLong_FromUnsignedLongLong(((uint64_t*) array->data)[i]);
+    case COLUMN_KIND_UINT8:
+        return PyInt_FromLong(((unsigned char*) array->data)[i]);
+    case COLUMN_KIND_BYTES:
+        offsets = (int64_t*) ((column_array_t*) array->offsets)->data;
+        return PyString_FromStringAndSize((char*) array->data + offsets[i], offsets[i + 1] - offsets[i]);
+    case COLUMN_KIND_OID:
+        offsets = (int64_t*) ((column_array_t*) array->offsets)->data;
+        py_value = PyTuple_New(offsets[i + 1] - offsets[i]);
+        for (j = 0; py_value && j < offsets[i + 1] - offsets[i]; j++) {
+            py_subid = PyInt_FromSize_t((size_t) ((uint64_t*) array->data)[offsets[i] + j]);
+            if (!py_subid) {
+                Py_CLEAR(py_value);
+                break;
+            }
+            PyTuple_SET_ITEM(py_value, j, py_subid);
+        }
+        return py_value;
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static int column_array_getbuffer(column_array_t* array, Py_buffer* view, int flags) {
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "column arrays are read-only");
+        view->obj = NULL;
+        return -1;
+    }
+    view->buf = array->data;
+    view->obj = (PyObject*) array;
+    Py_INCREF(array);
+    view->len = array->nitems * array->itemsize;
+    view->readonly = 1;
+    view->itemsize = array->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? array->format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? &array->nitems : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &array->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+/* old style buffer protocol, for consumers like buffer() and numpy.frombuffer on python 2 */
+static Py_ssize_t column_array_getreadbuffer(column_array_t* array, Py_ssize_t segment, void** ptr) {
+    if (segment != 0) {
+        PyErr_SetString(PyExc_SystemError, "accessing non-existent column array segment");
+        return -1;
+    }
+    *ptr = array->data;
+    return array->nitems * array->itemsize;
+}
+
+static Py_ssize_t column_array_getsegcount(column_array_t* array, Py_ssize_t* lenp) {
+    if (lenp)
+        *lenp = array->nitems * array->itemsize;
+    return 1;
+}
+
+static PyObject* column_array_get_kind(column_array_t* array, void* closure) {
+    switch (array->kind) {
+    case COLUMN_KIND_INT64:
+        return PyString_FromString("int64");
+    case COLUMN_KIND_UINT64:
+        return PyString_FromString("uint64");
+    case COLUMN_KIND_BYTES:
+        return PyString_FromString("bytes");
+    case COLUMN_KIND_OID:
+        return PyString_FromString("oid");
+    case COLUMN_KIND_UINT8:
+        return PyString_FromString("uint8");
+    }
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject* column_array_get_offsets(column_array_t* array, void* closure) {
+    PyObject* py_obj = array->offsets ? array->offsets : Py_None;
+    Py_INCREF(py_obj);
+    return py_obj;
+}
+
+static PyObject* column_array_get_valid(column_array_t* array, void* closure) {
+    PyObject* py_obj = array->valid ? array->valid : Py_None;
+    Py_INCREF(py_obj);
+    return py_obj;
+}
+
+static PySequenceMethods column_array_as_sequence = {
+    (lenfunc) column_array_length,           /* sq_length */
+    0,                                       /* sq_concat */
+    0,                                       /* sq_repeat */
+    (ssizeargfunc) column_array_item,        /* sq_item */
+};
+
+static PyBufferProcs column_array_as_buffer = {
+    (readbufferproc) column_array_getreadbuffer, /* bf_getreadbuffer */
+    0,                                       /* bf_getwritebuffer */
+    (segcountproc) column_array_getsegcount, /* bf_getsegcount */
+    0,                                       /* bf_getcharbuffer */
+    (getbufferproc) column_array_getbuffer,  /* bf_getbuffer */
+    0,                                       /* bf_releasebuffer */
+};
+
+static PyGetSetDef column_array_getset[] = {
+    { "kind", (getter) column_array_get_kind, NULL,
+            "Element type: int64, uint64, bytes, oid or uint8.", NULL },
+    { "offsets", (getter) column_array_get_offsets, NULL,
+            "For bytes and oid arrays, rows + 1 int64 offsets into the buffer, else None.", NULL },
+    { "valid", (getter) column_array_get_valid, NULL,
+            "uint8 array, 1 where the row has a cell of this column. None for the index.", NULL },
+    { NULL }
+};
+
+PyTypeObject ColumnArrayType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "netsnmptable.interface.ColumnArray",    /* tp_name */
+    sizeof(column_array_t),                  /* tp_basicsize */
+    0,                                       /* tp_itemsize */
+    (destructor) column_array_dealloc,       /* tp_dealloc */
+    0,                                       /* tp_print */
+    0,                                       /* tp_getattr */
+    0,                                       /* tp_setattr */
+    0,                                       /* tp_compare */
+    0,                                       /* tp_repr */
+    0,                                       /* tp_as_number */
+    &column_array_as_sequence,               /* tp_as_sequence */
+    0,                                       /* tp_as_mapping */
+    0,                                       /* tp_hash */
+    0,                                       /* tp_call */
+    0,                                       /* tp_str */
+    0,                                       /* tp_getattro */
+    0,                                       /* tp_setattro */
+    &column_array_as_buffer,                 /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
+    "Read-only typed array of one table column, supports the buffer protocol.", /* tp_doc */
+    0,                                       /* tp_traverse */
+    0,                                       /* tp_clear */
+    0,                                       /* tp_richcompare */
+    0,                                       /* tp_weaklistoffset */
+    0,                                       /* tp_iter */
+    0,                                       /* tp_iternext */
+    0,                                       /* tp_methods */
+    0,                                       /* tp_members */
+    column_array_getset,                     /* tp_getset */
+};
+
+/*
+ * Result layout
+ */
+
+static int compare_row_entries(const void* a, const void* b) {
+    const oid_map_entry_t* ea = *(const oid_map_entry_t* const*) a;
+    const oid_map_entry_t* eb = *(const oid_map_entry_t* const*) b;
+
+    return snmp_oid_compare(ea->key, ea->key_len, eb->key, eb->key_len);
+}
+
+/* Attach an offsets array with rows + 1 entries to array. Return value: Borrowed pointer to its data. */
+static int64_t* add_offsets(column_array_t* array) {
+    column_array_t* offsets = column_array_new(COLUMN_KIND_INT64, array->rows + 1, array->rows + 1);
+
+    if (!offsets)
+        return NULL;
+    array->offsets = (PyObject*) offsets;
+    return (int64_t*) offsets->data;
+}
+
+/* Lay out the cells of one column in row order. position maps row numbers to row positions. */
+static column_array_t* layout_column(columnar_column_t* column, size_t* position, Py_ssize_t rows) {
+    columnar_cell_t* cells = (columnar_cell_t*) column->cells.data;
+    size_t nr_of_cells = column->cells.len / sizeof(columnar_cell_t);
+    int kind = column->kind != COLUMN_KIND_NONE ? column->kind : COLUMN_KIND_INT64;
+    int variable_size = (kind == COLUMN_KIND_BYTES || kind == COLUMN_KIND_OID);
+    size_t elemsize = (kind == COLUMN_KIND_OID) ? sizeof(uint64_t) : 1;
+    column_array_t* array;
+    column_array_t* valid;
+    unsigned char* valid_data;
+    int64_t* offsets = NULL;
+    size_t i, pos;
+
+    array = column_array_new(kind, rows,
+            variable_size ? (Py_ssize_t) (column->blob.len / elemsize) : rows);
+    if (!array)
+        return NULL;
+
+    valid = column_array_new(COLUMN_KIND_UINT8, rows, rows);
+    if (!valid)
+        goto fail;
+    array->valid = (PyObject*) valid;
+    valid_data = (unsigned char*) valid->data;
+
+    if (variable_size) {
+        /* lengths first, then turn them into offsets */
+        offsets = add_offsets(array);
+        if (!offsets)
+            goto fail;
+        for (i = 0; i < nr_of_cells; i++) {
+            offsets[position[cells[i].row_nr] + 1] = cells[i].len;
+        }
+        for (pos = 0; pos < (size_t) rows; pos++) {
+            offsets[pos + 1] += offsets[pos];
+        }
+    }
+
+    for (i = 0; i < nr_of_cells; i++) {
+        pos = position[cells[i].row_nr];
+        valid_data[pos] = 1;
+        if (variable_size) {
+            memcpy((char*) array->data + offsets[pos] * elemsize,
+                    column->blob.data + cells[i].value * elemsize, cells[i].len * elemsize);
+        } else {
+            ((uint64_t*) array->data)[pos] = cells[i].value;
+        }
+    }
+    return array;
+
+    fail:
+    Py_DECREF(array);
+    return NULL;
+}
+
+/*
+ * Build the result of a columnar walk from the row cache and the collected cells.
+ * Must be called before table_walk_finish.
+ *
+ * Return value: New reference to a tuple (index, columns). index is an oid array with the instance
+ * OID suffix of each row, in ascending order. columns maps each fetched column name to its array.
+ * NULL with exception set on error.
+ */
+PyObject* columnar_result(table_info_t* table_info) {
+    oid_map_t* row_cache = &table_info->row_cache;
+    columnar_t* columnar;
+    oid_map_entry_t** entries = NULL;
+    size_t* position = NULL;
+    column_array_t* index = NULL;
+    column_array_t* array;
+    PyObject* py_columns = NULL;
+    PyObject* py_result = NULL;
+    int64_t* offsets;
+    uint64_t* subids;
+    size_t rows = row_cache->used;
+    size_t nr_of_subids = 0;
+    size_t i, j;
+    int col;
+
+    /* no cell at all, e.g. an empty table */
+    if (!table_info->columnar)
+        table_info->columnar = columnar_allocate(table_info->column_scheme.fields);
+    columnar = table_info->columnar;
+
+    entries = malloc((rows ? rows : 1) * sizeof(oid_map_entry_t*));
+    position = malloc((rows ? rows : 1) * sizeof(size_t));
+    if (!columnar || !entries || !position) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0, j = 0; i < row_cache->size; i++) {
+        if (row_cache->slots[i].key) {
+            entries[j++] = &row_cache->slots[i];
+            nr_of_subids += row_cache->slots[i].key_len;
+        }
+    }
+    qsort(entries, rows, sizeof(oid_map_entry_t*), compare_row_entries);
+
+    /* index array, and the position of each row number */
+    index = column_array_new(COLUMN_KIND_OID, rows, nr_of_subids);
+    if (!index || !(offsets = add_offsets(index)))
+        goto done;
+    subids = (uint64_t*) index->data;
+    for (i = 0; i < rows; i++) {
+        position[((row_t*) entries[i]->data)->nr] = i;
+        offsets[i + 1] = offsets[i] + entries[i]->key_len;
+        for (j = 0; j < entries[i]->key_len; j++) {
+            subids[offsets[i] + j] = entries[i]->key[j];
+        }
+    }
+
+    py_columns = PyDict_New();
+    if (!py_columns)
+        goto done;
+    for (col = 0; col < table_info->column_scheme.fields; col++) {
+        if (!table_info->column_scheme.column[col].selected)
+            continue;
+        array = layout_column(&columnar->column[col], position, rows);
+        if (!array || PyDict_SetItem(py_columns, table_info->column_scheme.column[col].py_label_str,
+                (PyObject*) array) < 0) {
+            Py_XDECREF(array);
+            goto done;
+        }
+        Py_DECREF(array);
+    }
+
+    py_result = PyTuple_Pack(2, (PyObject*) index, py_columns);
+
+    done:
+    Py_XDECREF(index);
+    Py_XDECREF(py_columns);
+    free(entries);
+    free(position);
+    return py_result;
+}
@@ -0,0 +1,66 @@
+#ifndef COLUMNAR_H_
+#define COLUMNAR_H_
+
+#include <Python.h>
+#include <stdint.h>
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include "util.h"
+#include "table.h"
+
+/* element type of a column array */
+#define COLUMN_KIND_NONE 0   // column had no cell yet
+#define COLUMN_KIND_INT64 1  // INTEGER
+#define COLUMN_KIND_UINT64 2 // Counter32, Gauge32, TimeTicks, Unsigned32, Counter64
+#define COLUMN_KIND_BYTES 3  // OCTET STRING, IpAddress, Opaque, BITS - byte blob plus offsets
+#define COLUMN_KIND_OID 4    // OBJECT IDENTIFIER - uint64 sub-identifiers plus offsets
+#define COLUMN_KIND_UINT8 5  // valid masks
+
+/* growable byte buffer */
+typedef struct columnar_buf_s {
+    char* data;
+    size_t len;
+    size_t cap;
+} columnar_buf_t;
+
+/* one received cell, in arrival order */
+typedef struct columnar_cell_s {
+    size_t row_nr;      // row number from the row cache, in order of row creation
+    uint64_t value;     // value of fixed size kinds, start in blob for variable size kinds
+    size_t len;         // element count in blob for variable size kinds
+} columnar_cell_t;
+
+/* cells of one column - one per column */
+typedef struct columnar_column_s {
+    int kind;
+    columnar_buf_t cells; // columnar_cell_t
+    columnar_buf_t blob;  // octets, or uint64 sub-identifiers
+} columnar_column_t;
+
+/* columnar walk state - one per walk */
+typedef struct columnar_s {
+    int nr_of_columns;
+    columnar_column_t* column;
+} columnar_t;
+
+/* read-only typed array, exposed through the buffer protocol */
+typedef struct column_array_s {
+    PyObject_HEAD
+    int kind;
+    char* format;            // struct module format of one buffer item
+    Py_ssize_t itemsize;
+    Py_ssize_t nitems;       // buffer items, equals rows for fixed size kinds
+    Py_ssize_t rows;
+    void* data;
+    PyObject* offsets;       // rows + 1 int64 item offsets into data, for variable size kinds, else NULL
+    PyObject* valid;         // rows uint8, 1 where the row has a cell of this column, else NULL
+} column_array_t;
+
+extern PyTypeObject ColumnArrayType;
+
+extern columnar_t* columnar_allocate(int nr_of_columns);
+extern void columnar_deallocate(columnar_t* columnar);
+extern int columnar_store(columnar_t* columnar, int col, size_t row_nr, netsnmp_variable_list *vars);
+extern PyObject* columnar_result(table_info_t* table_info);
+
+#endif /* COLUMNAR_H_ */
@@ -0,0 +1,339 @@
+/*
+ * Row filters, evaluated on raw response varbinds.
+ *
+ * A filter expression from python is compiled into a tree of nodes. Its leaves, the atoms, compare
+ * one column with constants. Atoms are evaluated per cell while a response is decoded, and their
+ * results are kept as bits in the row. Rows the filter rejects never get python objects.
+ */
+
+#include <Python.h>
+#include "filter.h"
+
+static const struct {
+    const char* name;
+    int kind;
+} kinds[] = {
+    { "and", FILTER_AND }, { "or", FILTER_OR }, { "not", FILTER_NOT },
+    { "==", FILTER_EQ }, { "!=", FILTER_NE }, { "<", FILTER_LT }, { "<=", FILTER_LE },
+    { ">", FILTER_GT }, { ">=", FILTER_GE }, { "in", FILTER_IN }, { "prefix", FILTER_PREFIX },
+};
+
+/*
+ * Append a node. Returns its number, -1 with exception set if out of memory.
+ * Nodes move when the array grows, so they are referred to by number.
+ */
+static int add_node(filter_t* filter, int kind) {
+    filter_node_t* nodes = realloc(filter->node, (filter->nr_of_nodes + 1) * sizeof(filter_node_t));
+
+    if (!nodes) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    filter->node = nodes;
+    memset(&nodes[filter->nr_of_nodes], 0, sizeof(filter_node_t));
+    nodes[filter->nr_of_nodes].kind = kind;
+    nodes[filter->nr_of_nodes].left = -1;
+    nodes[filter->nr_of_nodes].right = -1;
+    nodes[filter->nr_of_nodes].col = -1;
+    return filter->nr_of_nodes++;
+}
+
+/* Returns -1 with exception set if py_value is neither an integer nor a string. */
+static int set_const(filter_const_t* c, PyObject* py_value) {
+    if (PyString_Check(py_value)) {
+        c->is_bytes = 1;
+        c->len = PyString_GET_SIZE(py_value);
+        c->bytes = malloc(c->len ? c->len : 1);
+        if (!c->bytes) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        memcpy(c->bytes, PyString_AS_STRING(py_value), c->len);
+        return 0;
+    }
+    if (PyInt_Check(py_value) || PyLong_Check(py_value)) {
+        c->num = PyLong_AsLongLong(py_value);
+        return (c->num == -1 && PyErr_Occurred()) ? -1 : 0;
+    }
+    PyErr_SetString(PyExc_TypeError, "filter values must be integers or strings");
+    return -1;
+}
+
+/* Compile an atom (op, column name, values). Returns the node number, -1 with exception set on error. */
+static int compile_atom(filter_t* filter, table_info_t* table_info, int kind, PyObject* py_spec) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    filter_node_t* node;
+    PyObject* py_name = PyTuple_GET_ITEM(py_spec, 1);
+    PyObject* py_values;
+    Py_ssize_t i, n;
+    int nr, col, bit;
+
+    for (col = 0; col < column_scheme->fields; col++) {
+        if (PyObject_RichCompareBool(column_scheme->column[col].py_label_str, py_name, Py_EQ) == 1)
+            break;
+    }
+    if (col == column_scheme->fields) {
+        PyObject* py_repr = PyObject_Repr(py_name);
+        PyErr_Format(PyExc_ValueError, "%s is not a column of %s",
+                py_repr ? PyString_AsString(py_repr) : "?", TABLE_NAME(table_info));
+        Py_XDECREF(py_repr);
+        return -1;
+    }
+    if (filter->nr_of_atoms == FILTER_MAX_ATOMS) {
+        PyErr_Format(PyExc_ValueError, "filters have at most %d comparisons", FILTER_MAX_ATOMS);
+        return -1;
+    }
+
+    py_values = PySequence_Fast(PyTuple_GET_ITEM(py_spec, 2), "filter values must be a sequence");
+    if (!py_values)
+        return -1;
+    n = PySequence_Fast_GET_SIZE(py_values);
+    if ((kind != FILTER_IN && n != 1)
+            || (kind == FILTER_PREFIX && !PyString_Check(PySequence_Fast_GET_ITEM(py_values, 0)))) {
+        PyErr_SetString(PyExc_ValueError, "bad filter comparison");
+        Py_DECREF(py_values);
+        return -1;
+    }
+
+    nr = add_node(filter, kind);
+    if (nr < 0) {
+        Py_DECREF(py_values);
+        return -1;
+    }
+    node = &filter->node[nr];
+    node->col = col;
+    node->atom = filter->nr_of_atoms++;
+    node->consts = calloc(n ? n : 1, sizeof(filter_const_t));
+    if (!node->consts) {
+        PyErr_NoMemory();
+        Py_DECREF(py_values);
+        return -1;
+    }
+    for (i = 0; i < n; i++) {
+        node->nr_of_consts++;
+        if (set_const(&node->consts[i], PySequence_Fast_GET_ITEM(py_values, i)) < 0) {
+            Py_DECREF(py_values);
+            return -1;
+        }
+    }
+    Py_DECREF(py_values);
+
+    /* the filter needs the column, whether the caller asked for it or not, but rows only get asked ones */
+    if (!column_scheme->column[col].selected) {
+        column_scheme->column[col].selected = 1;
+        column_scheme->column[col].filter_only = 1;
+    }
+    if (filter->column_bit[col] < 0) {
+        bit = 0;
+        for (i = 0; i < column_scheme->fields; i++) {
+            if (filter->column_bit[i] >= 0)
+                bit++;
+        }
+        filter->column_bit[col] = bit;
+    }
+    return nr;
+}
+
+/* Returns the node number, -1 with exception set on error. */
+static int compile_node(filter_t* filter, table_info_t* table_info, PyObject* py_spec) {
+    const char* op;
+    size_t i;
+    int kind = -1;
+    int nr, left, right = -1;
+
+    if (!PyTuple_Check(py_spec) || PyTuple_GET_SIZE(py_spec) < 2
+            || !PyString_Check(PyTuple_GET_ITEM(py_spec, 0))) {
+        PyErr_SetString(PyExc_ValueError, "bad filter expression");
+        return -1;
+    }
+    op = PyString_AS_STRING(PyTuple_GET_ITEM(py_spec, 0));
+    for (i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if (!strcmp(kinds[i].name, op))
+            kind = kinds[i].kind;
+    }
+    if (kind < 0 || PyTuple_GET_SIZE(py_spec) != (kind == FILTER_NOT ? 2 : 3)) {
+        PyErr_Format(PyExc_ValueError, "bad filter operation %s", op);
+        return -1;
+    }
+    if (kind > FILTER_NOT)
+        return compile_atom(filter, table_info, kind, py_spec);
+
+    left = compile_node(filter, table_info, PyTuple_GET_ITEM(py_spec, 1));
+    if (left < 0)
+        return -1;
+    if (kind != FILTER_NOT && (right = compile_node(filter, table_info, PyTuple_GET_ITEM(py_spec, 2))) < 0)
+        return -1;
+    nr = add_node(filter, kind);
+    if (nr < 0)
+        return -1;
+    filter->node[nr].left = left;
+    filter->node[nr].right = right;
+    return nr;
+}
+
+/*
+ * Compile a filter expression for the columns of a table. py_spec is a nested tuple as built by
+ * netsnmptable.Column and netsnmptable.Condition: ("and" | "or", spec, spec), ("not", spec), or
+ * (op, column name, values) with op one of "==", "!=", "<", "<=", ">", ">=", "in", "prefix".
+ * Columns the filter refers to are selected for fetching, as filter_only if not selected yet.
+ *
+ * Return value: New filter, NULL with exception set on error.
+ */
+filter_t* filter_compile(table_info_t* table_info, PyObject* py_spec) {
+    filter_t* filter = calloc(1, sizeof(filter_t));
+    int col;
+
+    if (!filter)
+        return (filter_t*) PyErr_NoMemory();
+    filter->column_bit = malloc((table_info->column_scheme.fields ? table_info->column_scheme.fields : 1)
+            * sizeof(int));
+    if (!filter->column_bit) {
+        free(filter);
+        return (filter_t*) PyErr_NoMemory();
+    }
+    for (col = 0; col < table_info->column_scheme.fields; col++)
+        filter->column_bit[col] = -1;
+
+    filter->root = compile_node(filter, table_info, py_spec);
+    if (filter->root < 0) {
+        filter_free(filter);
+        return NULL;
+    }
+    return filter;
+}
+
+void filter_free(filter_t* filter) {
+    int i, j;
+
+    if (!filter)
+        return;
+    for (i = 0; i < filter->nr_of_nodes; i++) {
+        for (j = 0; j < filter->node[i].nr_of_consts; j++)
+            free(filter->node[i].consts[j].bytes);
+        free(filter->node[i].consts);
+    }
+    free(filter->node);
+    free(filter->column_bit);
+    free(filter);
+}
+
+/*
+ * Compare a cell with a constant, like strcmp. Integers compare by value, whatever their ASN type,
+ * octet strings byte by byte. Returns 0 if they can't be compared, e.g. an integer with a string.
+ */
+static int compare(netsnmp_variable_list* vars, filter_const_t* c, int* cmp) {
+    unsigned PY_LONG_LONG u;
+    size_t len;
+
+    switch (vars->type) {
+    case ASN_INTEGER:
+        if (c->is_bytes)
+            return 0;
+        *cmp = (*vars->val.integer > c->num) - (*vars->val.integer < c->num);
+        return 1;
+    case ASN_COUNTER:
+    case ASN_GAUGE:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+    case ASN_COUNTER64:
+        if (c->is_bytes)
+            return 0;
+        if (vars->type == ASN_COUNTER64)
+            u = ((unsigned PY_LONG_LONG) (vars->val.counter64->high & 0xffffffffUL) << 32)
+                    | (vars->val.counter64->low & 0xffffffffUL);
+        else
+            u = (u_long) *vars->val.integer;
+        if (c->num < 0)
+            *cmp = 1;
+        else
+            *cmp = (u > (unsigned PY_LONG_LONG) c->num) - (u < (unsigned PY_LONG_LONG) c->num);
+        return 1;
+    case ASN_OCTET_STR:
+    case ASN_OPAQUE:
+    case ASN_IPADDRESS:
+    case ASN_BIT_STR:
+        if (!c->is_bytes)
+            return 0;
+        len = vars->val_len < c->len ? vars->val_len : c->len;
+        *cmp = len ? memcmp(vars->val.string, c->bytes, len) : 0;
+        if (*cmp == 0)
+            *cmp = (vars->val_len > c->len) - (vars->val_len < c->len);
+        return 1;
+    }
+    return 0;
+}
+
+static int atom_holds(filter_node_t* node, netsnmp_variable_list* vars) {
+    int cmp = 0;
+    int i;
+
+    switch (node->kind) {
+    case FILTER_EQ:
+        return compare(vars, &node->consts[0], &cmp) && cmp == 0;
+    case FILTER_NE:
+        return !(compare(vars, &node->consts[0], &cmp) && cmp == 0);
+    case FILTER_LT:
+        return compare(vars, &node->consts[0], &cmp) && cmp < 0;
+    case FILTER_LE:
+        return compare(vars, &node->consts[0], &cmp) && cmp <= 0;
+    case FILTER_GT:
+        return compare(vars, &node->consts[0], &cmp) && cmp > 0;
+    case FILTER_GE:
+        return compare(vars, &node->consts[0], &cmp) && cmp >= 0;
+    case FILTER_IN:
+        for (i = 0; i < node->nr_of_consts; i++) {
+            if (compare(vars, &node->consts[i], &cmp) && cmp == 0)
+                return 1;
+        }
+        return 0;
+    case FILTER_PREFIX:
+        return (vars->type == ASN_OCTET_STR || vars->type == ASN_OPAQUE)
+                && vars->val_len >= node->consts[0].len
+                && memcmp(vars->val.string, node->consts[0].bytes, node->consts[0].len) == 0;
+    }
+    return 0;
+}
+
+/*
+ * Evaluate the atoms on the cell of column col in row. Doesn't need the GIL.
+ * Exception values count as missing cells, where all atoms are false.
+ */
+void filter_cell(filter_t* filter, row_t* row, int col, netsnmp_variable_list* vars) {
+    filter_node_t* node;
+    int bit = filter->column_bit[col];
+    int i;
+
+    if (bit < 0)
+        return;
+    row->filter_seen |= (uint64_t) 1 << bit;
+    if (vars->type == ASN_NULL || vars->type == SNMP_NOSUCHOBJECT
+            || vars->type == SNMP_NOSUCHINSTANCE || vars->type == SNMP_ENDOFMIBVIEW)
+        return;
+    for (i = 0; i < filter->nr_of_nodes; i++) {
+        node = &filter->node[i];
+        if (node->col == col && atom_holds(node, vars))
+            row->filter_atoms |= (uint64_t) 1 << node->atom;
+    }
+}
+
+static int eval(filter_t* filter, row_t* row, int nr) {
+    filter_node_t* node = &filter->node[nr];
+
+    switch (node->kind) {
+    case FILTER_AND:
+        return eval(filter, row, node->left) && eval(filter, row, node->right);
+    case FILTER_OR:
+        return eval(filter, row, node->left) || eval(filter, row, node->right);
+    case FILTER_NOT:
+        return !eval(filter, row, node->left);
+    }
+    return (int) ((row->filter_atoms >> node->atom) & 1);
+}
+
+/*
+ * Decide a row from the atoms evaluated so far, cells that didn't arrive count as missing.
+ * Doesn't need the GIL. Returns FILTER_ACCEPT or FILTER_REJECT.
+ */
+int filter_row(filter_t* filter, row_t* row) {
+    return eval(filter, row, filter->root) ? FILTER_ACCEPT : FILTER_REJECT;
+}
@@ -0,0 +1,66 @@
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <Python.h>
+#include <stdint.h>
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include "table.h"
+
+/* node kinds of a compiled row filter */
+#define FILTER_AND 0
+#define FILTER_OR 1
+#define FILTER_NOT 2
+#define FILTER_EQ 3      // atoms compare a cell of one column with constants
+#define FILTER_NE 4
+#define FILTER_LT 5
+#define FILTER_LE 6
+#define FILTER_GT 7
+#define FILTER_GE 8
+#define FILTER_IN 9
+#define FILTER_PREFIX 10
+
+/* up to this many atoms, each is one bit of a row */
+#define FILTER_MAX_ATOMS 64
+
+/* verdict of a row, see row_t */
+#define FILTER_UNKNOWN 0
+#define FILTER_ACCEPT 1
+#define FILTER_REJECT 2
+
+/* constant of an atom, an integer or an octet string */
+typedef struct filter_const_s {
+    int is_bytes;
+    PY_LONG_LONG num;
+    char* bytes;
+    size_t len;
+} filter_const_t;
+
+typedef struct filter_node_s {
+    int kind;
+    int left, right;         // operand nodes of AND, OR and NOT
+    int col;                 // column of an atom
+    int atom;                // bit of an atom in row_t.filter_atoms
+    filter_const_t* consts;
+    int nr_of_consts;
+} filter_node_t;
+
+/*
+ * Row filter compiled from a python expression, see filter_compile.
+ * Atoms are evaluated per cell while decoding responses, without the GIL. Once every column the filter
+ * refers to has delivered its cell of a row, or has passed the row, the node tree decides the row.
+ */
+typedef struct filter_s {
+    filter_node_t* node;
+    int nr_of_nodes;
+    int root;
+    int nr_of_atoms;
+    int* column_bit;         // per table column, its bit in row_t.filter_seen, or -1 if not referred to
+} filter_t;
+
+extern filter_t* filter_compile(table_info_t* table_info, PyObject* py_spec);
+extern void filter_free(filter_t* filter);
+extern void filter_cell(filter_t* filter, row_t* row, int col, netsnmp_variable_list* vars);
+extern int filter_row(filter_t* filter, row_t* row);
+
+#endif /* FILTER_H_ */
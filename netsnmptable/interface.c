@@ -4,6 +4,12 @@
 #include "interface.h"
 #include "util.h"
 #include "table.h"
+#include "poller.h"
+#include "iterator.h"
+#include "columnar.h"
+#include "schema.h"
+#include "capture.h"
+#include "filter.h"
 
 PyObject* netsnmptable_parse_mib(PyObject *self, PyObject *args) {
     PyObject* py_table = NULL;
@@ -84,16 +90,258 @@ PyObject* netsnmptable_cleanup(PyObject *self, PyObject *args) {
     done: return Py_BuildValue("");
 }
 
+/*
+ * Get the netsnmp session pointer from a python Session instance.
+ * Returns NULL with exception set on error.
+ */
+static void* get_session_ptr(PyObject* py_session) {
+    long ss_opaque = py_netsnmp_attr_long(py_session, "sess_ptr");
+
+    if (ss_opaque < 0) {
+        PyErr_SetString(PyExc_TypeError,
+                "Session object has no sess_ptr attribute");
+        return NULL;
+    } else if ((void*)ss_opaque == NULL) {
+        PyErr_SetString(PyExc_RuntimeError,
+                "Session pointer not initialized");
+        return NULL;
+    }
+    return (void*)ss_opaque;
+}
+
+/*
+ * Publish the statistics of the most recent fetch as stats attribute of the Table.
+ * Returns -1 with exception set on error.
+ */
+static int set_stats(PyObject* py_table, table_info_t* tbl) {
+    PyObject* py_stats = table_get_stats(tbl);
+    int ret;
+
+    if (!py_stats)
+        return -1;
+    ret = PyObject_SetAttrString(py_table, "stats", py_stats);
+    Py_DECREF(py_stats);
+    return ret;
+}
+
+/*
+ * Publish the scalar values of the most recent fetch as scalar_values attribute of the Table.
+ * Returns -1 with exception set on error.
+ */
+static int set_scalar_values(PyObject* py_table, table_info_t* tbl) {
+    PyObject* py_values = table_get_scalar_values(tbl);
+    int ret;
+
+    if (!py_values)
+        return -1;
+    ret = PyObject_SetAttrString(py_table, "scalar_values", py_values);
+    Py_DECREF(py_values);
+    return ret;
+}
+
+/*
+ * Get the parsed table structure from a python Table instance.
+ * Returns NULL with exception set on error.
+ */
+static table_info_t* get_table_ptr(PyObject* py_table) {
+    long tbl = py_netsnmp_attr_long(py_table, "_tbl_ptr");
+
+    if (tbl < 0) {
+        PyErr_SetString(PyExc_TypeError,
+                "Table object has no _tbl_ptr attribute");
+        return NULL;
+    } else if ((void*)tbl == NULL) {
+        PyErr_SetString(PyExc_RuntimeError,
+                "Table structure not initialized");
+        return NULL;
+    }
+    return (table_info_t*) tbl;
+}
+
+/*
+ * Apply session settings and fetch options to a table before a walk.
+ * py_opts is the object carrying the fetch options as attributes
+ * (max_repeaters, adaptive_repeaters, value_mode, layout, fetch_columns, row_filter, fetch_scalars,
+ * resume_cursor, end_iid).
+ * Returns -1 with exception set on error.
+ */
+static int configure_fetch(table_info_t* tbl, PyObject* py_session, PyObject* py_opts,
+        PyObject* py_iid, long* max_repeaters) {
+    char *value_mode = NULL;
+    char *layout = NULL;
+    PyObject* py_columns = NULL;
+    PyObject* py_filter = NULL;
+    PyObject* py_scalars = NULL;
+    PyObject* py_cursor = NULL;
+    PyObject* py_end_iid = NULL;
+    int ret;
+
+    tbl->getlabel_flag = NO_FLAGS;
+    tbl->sprintval_flag = USE_BASIC;
+    if (py_netsnmp_attr_long(py_session, "UseLongNames"))
+        tbl->getlabel_flag |= USE_LONG_NAMES;
+    if (py_netsnmp_attr_long(py_session, "UseNumeric"))
+        tbl->getlabel_flag |= USE_NUMERIC_OIDS;
+    if (py_netsnmp_attr_long(py_session, "UseLongNames"))
+        tbl->getlabel_flag |= USE_LONG_NAMES;
+    if (py_netsnmp_attr_long(py_session, "UseEnums"))
+        tbl->sprintval_flag = USE_ENUMS;
+    if (py_netsnmp_attr_long(py_session, "UseSprintValue"))
+        tbl->sprintval_flag = USE_SPRINT_VALUE;
+    /* SNMPv1 has no GETBULK */
+    tbl->use_getnext = py_netsnmp_attr_long(py_session, "Version") == 1;
+
+    tbl->value_mode = VALUE_MODE_VARBIND;
+    if (py_netsnmp_attr_string(py_opts, "value_mode", &value_mode, NULL) == 0 && value_mode) {
+        if (!strcmp(value_mode, "native")) {
+            tbl->value_mode = VALUE_MODE_NATIVE;
+        } else if (!strcmp(value_mode, "rate")) {
+            tbl->value_mode = VALUE_MODE_RATE;
+        } else if (strcmp(value_mode, "varbind")) {
+            PyErr_SetString(PyExc_ValueError,
+                    "value_mode must be 'varbind', 'native' or 'rate'");
+            return -1;
+        }
+    }
+
+    tbl->layout = LAYOUT_ROWS;
+    if (py_netsnmp_attr_string(py_opts, "layout", &layout, NULL) == 0 && layout) {
+        if (!strcmp(layout, "columnar")) {
+            tbl->layout = LAYOUT_COLUMNAR;
+        } else if (!strcmp(layout, "changes")) {
+            tbl->layout = LAYOUT_CHANGES;
+        } else if (strcmp(layout, "rows")) {
+            PyErr_SetString(PyExc_ValueError,
+                    "layout must be 'rows', 'columnar' or 'changes'");
+            return -1;
+        }
+    }
+
+    /* rates are computed per row, columnar cells would ignore them */
+    if (tbl->value_mode == VALUE_MODE_RATE && tbl->layout != LAYOUT_ROWS) {
+        PyErr_SetString(PyExc_ValueError, "value_mode 'rate' needs layout 'rows'");
+        return -1;
+    }
+
+    *max_repeaters = py_netsnmp_attr_long(py_opts, "max_repeaters");
+    if (*max_repeaters < 0) {
+        PyErr_SetString(PyExc_RuntimeError,
+                "Table object has no max_repeaters attribute");
+        return -1;
+    }
+    tbl->repeaters.adaptive = py_netsnmp_attr_long(py_opts, "adaptive_repeaters") > 0;
+    tbl->collect_stats = py_netsnmp_attr_long(py_opts, "collect_stats") > 0;
+
+    py_columns = py_netsnmp_attr_obj(py_opts, "fetch_columns");
+    ret = table_select_columns(tbl, py_columns);
+    Py_XDECREF(py_columns);
+    if (ret < 0)
+        return -1;
+
+    /* after the columns, the filter selects the ones it refers to */
+    filter_free(tbl->filter);
+    tbl->filter = NULL;
+    py_filter = py_netsnmp_attr_obj(py_opts, "row_filter");
+    if (py_filter && py_filter != Py_None) {
+        if (tbl->layout != LAYOUT_ROWS) {
+            PyErr_SetString(PyExc_ValueError, "row filters need layout 'rows'");
+            ret = -1;
+        } else if (!(tbl->filter = filter_compile(tbl, py_filter))) {
+            ret = -1;
+        }
+    }
+    Py_XDECREF(py_filter);
+    if (ret < 0)
+        return -1;
+
+    py_scalars = py_netsnmp_attr_obj(py_opts, "fetch_scalars");
+    ret = table_set_scalars(tbl, py_scalars);
+    Py_XDECREF(py_scalars);
+    if (ret < 0)
+        return -1;
+
+    py_cursor = py_netsnmp_attr_obj(py_opts, "resume_cursor");
+    ret = table_set_cursor(tbl, py_cursor);
+    Py_XDECREF(py_cursor);
+    if (ret < 0)
+        return -1;
+
+    tbl->column_scheme.start_idx_length = 0;
+    if (py_iid && py_iid != Py_None) {
+        py_netsnmp_attr_get_oid(py_iid, tbl->column_scheme.start_idx,
+                MAX_OID_LEN - tbl->column_scheme.name_length - 1,
+                &tbl->column_scheme.start_idx_length);
+    }
+
+    tbl->column_scheme.end_idx_length = 0;
+    py_end_iid = py_netsnmp_attr_obj(py_opts, "end_iid");
+    if (py_end_iid && py_end_iid != Py_None) {
+        ret = py_netsnmp_attr_get_oid(py_end_iid, tbl->column_scheme.end_idx,
+                MAX_OID_LEN - tbl->column_scheme.name_length - 1,
+                &tbl->column_scheme.end_idx_length);
+        if (ret < 0) {
+            Py_DECREF(py_end_iid);
+            return -1;
+        }
+    }
+    Py_XDECREF(py_end_iid);
+
+    return 0;
+}
+
+/*
+ * The previous counter values of value_mode 'rate' live in the Table's own table structure, and only
+ * a fetch of it can use and update them. Returns -1 with exception set for other fetches in rate mode.
+ */
+static int check_no_rates(table_info_t* tbl) {
+    if (tbl->value_mode == VALUE_MODE_RATE) {
+        PyErr_SetString(PyExc_ValueError, "value_mode 'rate' is only supported by Table.poll_rates");
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Prepare recording or replay of the responses of a fetch, as requested by the record_capture and
+ * replay_capture attributes of py_opts. *py_replay keeps the replayed data alive during the fetch.
+ * Returns -1 with exception set on error.
+ */
+static int configure_capture(table_info_t* tbl, PyObject* py_opts, capture_t* capture,
+        PyObject** py_replay) {
+    tbl->capture = NULL;
+    *py_replay = py_netsnmp_attr_obj(py_opts, "replay_capture");
+    if (*py_replay && *py_replay != Py_None) {
+        if (!PyString_Check(*py_replay)) {
+            PyErr_SetString(PyExc_TypeError, "replay_capture must be a string");
+            return -1;
+        }
+        if (capture_init_replay(capture, PyString_AS_STRING(*py_replay),
+                PyString_GET_SIZE(*py_replay)) < 0)
+            return -1;
+        tbl->capture = capture;
+    } else if (py_netsnmp_attr_long(py_opts, "record_capture") > 0) {
+        capture_init_record(capture);
+        tbl->capture = capture;
+    }
+    return 0;
+}
+
 PyObject* netsnmptable_fetch(PyObject *self, PyObject *args) {
     PyObject* py_table = NULL;
     PyObject* py_session = NULL;
     PyObject* py_val_tuple = NULL;
     PyObject* py_iid = NULL;
+    PyObject* py_cursor = NULL;
+    PyObject* py_replay = NULL;
+    PyObject* py_capture = NULL;
     table_info_t* tbl = NULL;
-    long ss_opaque = 0;
+    void* ss_opaque = NULL;
+    capture_t capture;
     long max_repeaters;
     int ret_exceptional = 0;
 
+    memset(&capture, 0, sizeof(capture));
+
     if (args) {
         if (!PyArg_ParseTuple(args, "OO", &py_table, &py_iid)) {
             goto done;
@@ -107,76 +355,527 @@ PyObject* netsnmptable_fetch(PyObject *self, PyObject *args) {
             goto done;
         }
 
-        /* get netsnmp session pointer from python Session instance */
-        ss_opaque = py_netsnmp_attr_long(py_session, "sess_ptr");
-        if (ss_opaque < 0) {
-            PyErr_SetString(PyExc_TypeError,
-                    "Session object has no sess_ptr attribute");
+        ss_opaque = get_session_ptr(py_session);
+        tbl = get_table_ptr(py_table);
+        if (!ss_opaque || !tbl
+                || configure_fetch(tbl, py_session, py_table, py_iid, &max_repeaters) < 0
+                || configure_capture(tbl, py_table, &capture, &py_replay) < 0) {
             ret_exceptional = 1;
             goto done;
-        } else if ((void*)ss_opaque == NULL) {
-            PyErr_SetString(PyExc_RuntimeError,
-                    "Session pointer not initialized");
+        }
+
+        if (tbl->value_mode == VALUE_MODE_RATE)
+            table_rates_begin(tbl);
+        py_val_tuple = table_getbulk_sub_entries(tbl, ss_opaque, max_repeaters, py_session);
+        if (py_val_tuple && (set_stats(py_table, tbl) < 0 || set_scalar_values(py_table, tbl) < 0)) {
+            Py_CLEAR(py_val_tuple);
             ret_exceptional = 1;
             goto done;
         }
 
-        /* get netsnmp session pointer from python Session instance */
-        tbl = (table_info_t*) py_netsnmp_attr_long(py_table, "_tbl_ptr");
-        if (tbl < 0) {
-            PyErr_SetString(PyExc_TypeError,
-                    "Table object has no _tbl_ptr attribute");
-            ret_exceptional = 1;
+        /* responses of this walk, for replay */
+        if (py_val_tuple && tbl->capture && !capture.replaying) {
+            py_capture = capture_result(&capture);
+            if (!py_capture || PyObject_SetAttrString(py_table, "capture", py_capture) < 0) {
+                Py_CLEAR(py_val_tuple);
+                ret_exceptional = 1;
+                goto done;
+            }
+        }
+
+        /* where to continue, if the walk stopped early */
+        if (py_val_tuple) {
+            py_cursor = table_get_cursor(tbl);
+            if (!py_cursor || PyObject_SetAttrString(py_table, "cursor", py_cursor) < 0) {
+                Py_CLEAR(py_val_tuple);
+                ret_exceptional = 1;
+            } else if (tbl->value_mode == VALUE_MODE_RATE && py_cursor == Py_None
+                    && table_rates_prune(tbl) < 0) {
+                /* after a complete poll, rows that weren't seen have gone */
+                PyErr_NoMemory();
+                Py_CLEAR(py_val_tuple);
+                ret_exceptional = 1;
+            }
+            Py_XDECREF(py_cursor);
+        }
+    }
+
+    done:
+    if (tbl)
+        tbl->capture = NULL;
+    capture_release(&capture);
+    Py_XDECREF(py_capture);
+    Py_XDECREF(py_replay);
+    Py_XDECREF(py_session);
+
+    if (ret_exceptional)
+        return NULL;
+
+    return (py_val_tuple ? py_val_tuple : Py_BuildValue(""));
+}
+
+/*
+ * Returns a dictionary that maps each column name of a table to its column OID tuple.
+ */
+PyObject* netsnmptable_column_oids(PyObject *self, PyObject *args) {
+    PyObject* py_table = NULL;
+    table_info_t* tbl = NULL;
+
+    if (!PyArg_ParseTuple(args, "O", &py_table))
+        return NULL;
+
+    tbl = get_table_ptr(py_table);
+    if (!tbl)
+        return NULL;
+    return table_get_column_oids(tbl);
+}
+
+/*
+ * Serialize the structure of a parsed table, see schema.h.
+ * Returns the schema as string.
+ */
+PyObject* netsnmptable_dump_schema(PyObject *self, PyObject *args) {
+    PyObject* py_table = NULL;
+    table_info_t* tbl = NULL;
+
+    if (!PyArg_ParseTuple(args, "O", &py_table))
+        return NULL;
+
+    tbl = get_table_ptr(py_table);
+    if (!tbl)
+        return NULL;
+    return schema_dump(tbl);
+}
+
+/*
+ * Create the table structure of a Table object from a schema written by table_dump_schema, without MIB.
+ * Fills the columns attribute like table_parse_mib, and returns the table pointer.
+ */
+PyObject* netsnmptable_load_schema(PyObject *self, PyObject *args) {
+    PyObject* py_table = NULL;
+    PyObject* py_columns_list = NULL;
+    table_info_t* tbl = NULL;
+    const char* data;
+    int len;
+    int col;
+
+    if (!PyArg_ParseTuple(args, "Os#", &py_table, &data, &len))
+        return NULL;
+
+    py_columns_list = py_netsnmp_attr_obj(py_table, "columns");
+    if (!py_columns_list) {
+        PyErr_SetString(PyExc_TypeError,
+                "Table object has no columns attribute.");
+        return NULL;
+    }
+
+    tbl = schema_load(data, len);
+    if (!tbl)
+        goto done;
+
+    for (col = 0; col < tbl->column_scheme.fields; col++) {
+        if (PyList_Append(py_columns_list, tbl->column_scheme.column[col].py_label_str) < 0) {
+            table_deallocate(tbl);
+            tbl = NULL;
             goto done;
         }
+    }
+    PyList_Reverse(py_columns_list);
 
-        tbl->getlabel_flag = NO_FLAGS;
-        tbl->sprintval_flag = USE_BASIC;
-        if (py_netsnmp_attr_long(py_session, "UseLongNames"))
-            tbl->getlabel_flag |= USE_LONG_NAMES;
-        if (py_netsnmp_attr_long(py_session, "UseNumeric"))
-            tbl->getlabel_flag |= USE_NUMERIC_OIDS;
-        if (py_netsnmp_attr_long(py_session, "UseLongNames"))
-            tbl->getlabel_flag |= USE_LONG_NAMES;
-        if (py_netsnmp_attr_long(py_session, "UseEnums"))
-            tbl->sprintval_flag = USE_ENUMS;
-        if (py_netsnmp_attr_long(py_session, "UseSprintValue"))
-            tbl->sprintval_flag = USE_SPRINT_VALUE;
-
-        max_repeaters = py_netsnmp_attr_long(py_table, "max_repeaters");
-        if (max_repeaters < 0) {
-            PyErr_SetString(PyExc_RuntimeError,
-                    "Table object has no max_repeaters attribute");
-            ret_exceptional = 1;
+    done:
+    Py_DECREF(py_columns_list);
+    return tbl ? PyLong_FromVoidPtr((void *) tbl) : NULL;
+}
+
+/*
+ * Parse a syntax name for table_from_schema, None gives TYPE_OTHER.
+ * Returns -1 with exception set if the name is unknown.
+ */
+static int schema_type(PyObject* py_syntax) {
+    int type;
+
+    if (py_syntax == Py_None)
+        return TYPE_OTHER;
+    if (!PyString_Check(py_syntax)) {
+        PyErr_SetString(PyExc_TypeError, "syntax must be a string");
+        return -1;
+    }
+    type = table_type_from_str(PyString_AS_STRING(py_syntax));
+    if (type < 0)
+        PyErr_Format(PyExc_ValueError, "unknown syntax %s", PyString_AS_STRING(py_syntax));
+    return type;
+}
+
+/*
+ * Create the table structure of a Table object from an explicit definition, without MIB.
+ * Takes the table, the conceptual row OID as sequence of ints, a sequence of (subid, name, syntax)
+ * column tuples, and a sequence of (syntax, fixed length, implied) index tuples.
+ * Fills the columns attribute like table_parse_mib, and returns the table pointer.
+ */
+PyObject* netsnmptable_from_schema(PyObject *self, PyObject *args) {
+    PyObject* py_table = NULL;
+    PyObject* py_root = NULL;
+    PyObject* py_columns = NULL;
+    PyObject* py_indexes = NULL;
+    PyObject* py_columns_list = NULL;
+    PyObject* py_label = NULL;
+    PyObject* py_syntax = NULL;
+    table_info_t* tbl = NULL;
+    oid root[MAX_OID_LEN];
+    size_t rootlen = 0;
+    unsigned long subid;
+    int fixed_len, implied;
+    int type;
+    unsigned char asn_type;
+    Py_ssize_t i;
+    int ret_exceptional = 1;
+
+    if (!PyArg_ParseTuple(args, "OOOO", &py_table, &py_root, &py_columns, &py_indexes))
+        return NULL;
+
+    py_columns_list = py_netsnmp_attr_obj(py_table, "columns");
+    if (!py_columns_list) {
+        PyErr_SetString(PyExc_TypeError,
+                "Table object has no columns attribute.");
+        return NULL;
+    }
+
+    if (py_netsnmp_attr_get_oid(py_root, root, MAX_OID_LEN - 1, &rootlen) < 0)
+        goto done;
+    tbl = table_allocate_oid(root, rootlen);
+    if (!tbl || table_set_oid_name(tbl) < 0) {
+        PyErr_NoMemory();
+        goto done;
+    }
+
+    for (i = 0; i < PySequence_Size(py_columns); i++) {
+        PyObject* py_column = PySequence_GetItem(py_columns, i);
+        int ok = py_column && PyArg_ParseTuple(py_column, "kSO", &subid, &py_label, &py_syntax);
+
+        Py_XDECREF(py_column);
+        if (!ok || (type = schema_type(py_syntax)) < 0)
+            goto done;
+        if (table_add_column(tbl, subid, py_label, type) < 0) {
+            PyErr_NoMemory();
             goto done;
         }
+    }
 
-        if (py_iid && py_iid != Py_None) {
-            py_netsnmp_attr_get_oid(py_iid, tbl->column_scheme.start_idx,
-                    sizeof(tbl->column_scheme.start_idx),
-                    &tbl->column_scheme.start_idx_length);
+    for (i = 0; i < PySequence_Size(py_indexes); i++) {
+        PyObject* py_index = PySequence_GetItem(py_indexes, i);
+        int ok = py_index && PyArg_ParseTuple(py_index, "Oii", &py_syntax, &fixed_len, &implied);
+
+        Py_XDECREF(py_index);
+        if (!ok || (type = schema_type(py_syntax)) < 0)
+            goto done;
+        /* same encoding as get_table_indexes */
+        asn_type = mib_to_asn_type(type);
+        if (asn_type == (u_char) -1) {
+            PyErr_SetString(PyExc_ValueError, "bad index syntax");
+            goto done;
         }
+        if (fixed_len > 0 || implied)
+            asn_type |= ASN_PRIVATE;
+        if (table_add_index(tbl, asn_type, fixed_len) < 0) {
+            PyErr_NoMemory();
+            goto done;
+        }
+    }
+
+    if (table_complete_columns(tbl) < 0) {
+        if (tbl->column_scheme.fields == 0)
+            PyErr_SetString(PyExc_ValueError, "table needs at least one column");
+        else
+            PyErr_NoMemory();
+        goto done;
+    }
+
+    for (i = 0; i < tbl->column_scheme.fields; i++) {
+        if (PyList_Append(py_columns_list, tbl->column_scheme.column[i].py_label_str) < 0)
+            goto done;
+    }
+    PyList_Reverse(py_columns_list);
+    ret_exceptional = 0;
 
-        py_val_tuple = table_getbulk_sub_entries(tbl, (void*)ss_opaque, max_repeaters, py_session);
+    done:
+    Py_DECREF(py_columns_list);
+    if (ret_exceptional) {
+        table_deallocate(tbl);
+        return NULL;
     }
+    return PyLong_FromVoidPtr((void *) tbl);
+}
+
+/*
+ * Create the table structure of a TableGroup object from the structures of its tables.
+ * Takes a sequence of Table objects, and returns the table pointer of the group.
+ */
+PyObject* netsnmptable_group(PyObject *self, PyObject *args) {
+    PyObject* py_tables = NULL;
+    PyObject* py_seq = NULL;
+    table_info_t** tables = NULL;
+    table_info_t* group = NULL;
+    Py_ssize_t i, n;
+
+    if (!PyArg_ParseTuple(args, "O", &py_tables))
+        return NULL;
+    py_seq = PySequence_Fast(py_tables, "tables must be a sequence of Table objects");
+    if (!py_seq)
+        return NULL;
+
+    n = PySequence_Fast_GET_SIZE(py_seq);
+    tables = calloc(n > 0 ? n : 1, sizeof(table_info_t*));
+    if (!tables) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0; i < n; i++) {
+        tables[i] = get_table_ptr(PySequence_Fast_GET_ITEM(py_seq, i));
+        if (!tables[i])
+            goto done;
+    }
+    group = table_group(tables, (int) n);
+
+    done:
+    free(tables);
+    Py_DECREF(py_seq);
+    if (!group)
+        return NULL;
+    return PyLong_FromVoidPtr((void *) group);
+}
+
+/*
+ * Fetch known rows of a table with GET requests.
+ * Takes the table, a sequence of index tuples and the number of varbinds per request.
+ */
+PyObject* netsnmptable_get_rows(PyObject *self, PyObject *args) {
+    PyObject* py_table = NULL;
+    PyObject* py_session = NULL;
+    PyObject* py_indexes = NULL;
+    PyObject* py_result = NULL;
+    table_info_t* tbl = NULL;
+    void* ss_opaque = NULL;
+    long max_repeaters;
+    int max_varbinds;
+
+    if (!PyArg_ParseTuple(args, "OOi", &py_table, &py_indexes, &max_varbinds))
+        return NULL;
+
+    py_session = py_netsnmp_attr_obj(py_table, "netsnmp_session");
+    if (!py_session) {
+        PyErr_SetString(PyExc_TypeError,
+                "Table object has no netsnmp_session attribute");
+        goto done;
+    }
+
+    ss_opaque = get_session_ptr(py_session);
+    tbl = get_table_ptr(py_table);
+    if (!ss_opaque || !tbl
+            || configure_fetch(tbl, py_session, py_table, NULL, &max_repeaters) < 0
+            || check_no_rates(tbl) < 0)
+        goto done;
+
+    py_result = table_get_rows(tbl, ss_opaque, py_indexes, max_varbinds, py_session);
+    if (py_result && set_stats(py_table, tbl) < 0)
+        Py_CLEAR(py_result);
 
     done:
     Py_XDECREF(py_session);
+    return py_result;
+}
 
-    if (ret_exceptional)
+/*
+ * Start a streaming walk of a table. Takes the same arguments as table_fetch.
+ * Returns an iterator that yields (index tuple, row dict) in index order.
+ */
+PyObject* netsnmptable_iter(PyObject *self, PyObject *args) {
+    PyObject* py_table = NULL;
+    PyObject* py_session = NULL;
+    PyObject* py_iid = NULL;
+    PyObject* py_iter = NULL;
+    table_info_t* tbl = NULL;
+    table_info_t* clone = NULL;
+    void* ss_opaque = NULL;
+    long max_repeaters;
+
+    if (!PyArg_ParseTuple(args, "OO", &py_table, &py_iid))
         return NULL;
 
-    return (py_val_tuple ? py_val_tuple : Py_BuildValue(""));
+    py_session = py_netsnmp_attr_obj(py_table, "netsnmp_session");
+    if (!py_session) {
+        PyErr_SetString(PyExc_TypeError,
+                "Table object has no netsnmp_session attribute");
+        goto done;
+    }
+
+    ss_opaque = get_session_ptr(py_session);
+    tbl = get_table_ptr(py_table);
+    if (!ss_opaque || !tbl)
+        goto done;
+
+    /* the iterator walks its own copy, the Table stays usable meanwhile */
+    clone = table_clone(tbl);
+    if (!clone) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    if (configure_fetch(clone, py_session, py_table, py_iid, &max_repeaters) < 0
+            || check_no_rates(clone) < 0) {
+        table_deallocate(clone);
+        goto done;
+    }
+
+    py_iter = table_iter_new(py_session, ss_opaque, clone, max_repeaters);
+
+    done:
+    Py_XDECREF(py_session);
+    return py_iter;
+}
+
+/*
+ * Walk many tables on many sessions concurrently.
+ * Takes a sequence of target objects, each with attributes key, session, table, iid and the fetch options.
+ * Returns a dictionary that maps each target key to its table dictionary, or to None on error.
+ * Errors are reported per target through the attributes of its session.
+ */
+PyObject* netsnmptable_poll(PyObject *self, PyObject *args) {
+    PyObject* py_targets = NULL;
+    PyObject* py_seq = NULL;
+    PyObject* py_result = NULL;
+    poll_target_t* targets = NULL;
+    PyObject** py_sessions = NULL;
+    PyObject** py_keys = NULL;
+    Py_ssize_t nr_of_targets = 0;
+    Py_ssize_t i;
+    int ret_exceptional = 0;
+
+    if (!PyArg_ParseTuple(args, "O", &py_targets))
+        return NULL;
+
+    py_seq = PySequence_Fast(py_targets, "expected a sequence of poll targets");
+    if (!py_seq)
+        return NULL;
+
+    nr_of_targets = PySequence_Fast_GET_SIZE(py_seq);
+    targets = calloc(nr_of_targets ? nr_of_targets : 1, sizeof(poll_target_t));
+    py_sessions = calloc(nr_of_targets ? nr_of_targets : 1, sizeof(PyObject*));
+    py_keys = calloc(nr_of_targets ? nr_of_targets : 1, sizeof(PyObject*));
+    if (!targets || !py_sessions || !py_keys) {
+        free(targets);
+        free(py_sessions);
+        free(py_keys);
+        Py_DECREF(py_seq);
+        return PyErr_NoMemory();
+    }
+
+    for (i = 0; i < nr_of_targets; i++) {
+        PyObject* py_target = PySequence_Fast_GET_ITEM(py_seq, i);
+        PyObject* py_table = py_netsnmp_attr_obj(py_target, "table");
+        PyObject* py_iid = py_netsnmp_attr_obj(py_target, "iid");
+        table_info_t* tbl = NULL;
+        long max_repeaters = 0;
+
+        py_keys[i] = py_netsnmp_attr_obj(py_target, "key");
+        py_sessions[i] = py_netsnmp_attr_obj(py_target, "session");
+        if (!py_keys[i] || !py_sessions[i] || !py_table) {
+            if (!PyErr_Occurred())
+                PyErr_SetString(PyExc_TypeError,
+                        "Poll target needs key, session and table attributes");
+        } else if ((targets[i].ss = get_session_ptr(py_sessions[i]))
+                && (tbl = get_table_ptr(py_table))) {
+            /* each target walks its own copy, so the same Table can be polled on many hosts */
+            targets[i].table_info = table_clone(tbl);
+            if (!targets[i].table_info) {
+                PyErr_NoMemory();
+            } else if (configure_fetch(targets[i].table_info, py_sessions[i], py_target,
+                    py_iid, &max_repeaters) == 0 && check_no_rates(targets[i].table_info) == 0) {
+                if (targets[i].table_info->layout == LAYOUT_CHANGES) {
+                    /* the snapshot belongs to the Table, a copy would compare against nothing */
+                    PyErr_SetString(PyExc_ValueError, "layout 'changes' can't be polled");
+                } else {
+                    targets[i].max_repeaters = max_repeaters;
+                    targets[i].py_table_dict = PyDict_New();
+                }
+            }
+        }
+        Py_XDECREF(py_table);
+        Py_XDECREF(py_iid);
+        if (PyErr_Occurred()) {
+            ret_exceptional = 1;
+            goto done;
+        }
+    }
+
+    poller_run(targets, nr_of_targets);
+    if (PyErr_Occurred()) {
+        ret_exceptional = 1;
+        goto done;
+    }
+
+    py_result = PyDict_New();
+    for (i = 0; py_result && i < nr_of_targets; i++) {
+        __py_netsnmp_update_session_errors(py_sessions[i], targets[i].err_str,
+                targets[i].err_num, targets[i].err_ind);
+        PyDict_SetItem(py_result, py_keys[i],
+                targets[i].py_table_dict ? targets[i].py_table_dict : Py_None);
+    }
+
+    done:
+    for (i = 0; i < nr_of_targets; i++) {
+        Py_XDECREF(targets[i].py_table_dict);
+        table_deallocate(targets[i].table_info);
+        Py_XDECREF(py_sessions[i]);
+        Py_XDECREF(py_keys[i]);
+    }
+    free(targets);
+    free(py_sessions);
+    free(py_keys);
+    Py_DECREF(py_seq);
+
+    if (ret_exceptional) {
+        Py_XDECREF(py_result);
+        return NULL;
+    }
+    return py_result;
 }
 
 static PyMethodDef InterfaceMethods[] = { { "table_parse_mib",
         netsnmptable_parse_mib, METH_VARARGS, "Get table structure from MIB." },
         { "table_fetch", netsnmptable_fetch, METH_VARARGS,
-                "Perform an SNMP table fetch." }, { "table_cleanup",
+                "Perform an SNMP table fetch." },
+        { "table_poll", netsnmptable_poll, METH_VARARGS,
+                "Perform SNMP table fetches on many sessions concurrently." },
+        { "table_iter", netsnmptable_iter, METH_VARARGS,
+                "Perform an SNMP table fetch row by row." },
+        { "table_get_rows", netsnmptable_get_rows, METH_VARARGS,
+                "Get known rows of an SNMP table." },
+        { "table_from_schema", netsnmptable_from_schema, METH_VARARGS,
+                "Create an SNMP table structure from an explicit definition." },
+        { "table_group", netsnmptable_group, METH_VARARGS,
+                "Combine SNMP table structures with the same indexes." },
+        { "table_column_oids", netsnmptable_column_oids, METH_VARARGS,
+                "Get the column OIDs of an SNMP table structure." },
+        { "table_dump_schema", netsnmptable_dump_schema, METH_VARARGS,
+                "Serialize the structure of an SNMP table." },
+        { "table_load_schema", netsnmptable_load_schema, METH_VARARGS,
+                "Create an SNMP table structure from a serialized schema." },
+        { "table_cleanup",
                 netsnmptable_cleanup, METH_VARARGS,
                 "Perform an SNMP table fetch." }, { NULL, NULL, 0, NULL } /* Sentinel */
 };
 
 PyMODINIT_FUNC initinterface(void) {
-    (void) Py_InitModule("interface", InterfaceMethods);
+    PyObject* module;
+
+    if (PyType_Ready(&TableIterType) < 0 || PyType_Ready(&ColumnArrayType) < 0)
+        return;
+
+    module = Py_InitModule("interface", InterfaceMethods);
+    if (!module)
+        return;
+
+    Py_INCREF(&TableIterType);
+    PyModule_AddObject(module, "TableIterator", (PyObject*) &TableIterType);
+    Py_INCREF(&ColumnArrayType);
+    PyModule_AddObject(module, "ColumnArray", (PyObject*) &ColumnArrayType);
 }
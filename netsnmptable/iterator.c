@@ -0,0 +1,140 @@
+/*
+ * Streaming table walk.
+ *
+ * Instead of building the complete table dictionary, rows are handed out as soon as every column has
+ * moved past them. Only rows of the current response window are held, whatever the size of the table.
+ */
+
+#include <Python.h>
+#include "iterator.h"
+
+#define SUCCESS (0)
+#define FAILURE (-1)
+
+/*
+ * Create an iterator that walks table_info, which must already be configured for the fetch.
+ * Takes ownership of table_info, also on error.
+ *
+ * Return value: New reference. NULL with exception set on error.
+ */
+PyObject* table_iter_new(PyObject* py_session, void* ss, table_info_t* table_info,
+        int max_repeaters) {
+    table_iter_t* iter;
+
+    iter = PyObject_New(table_iter_t, &TableIterType);
+    if (!iter) {
+        table_deallocate(table_info);
+        return NULL;
+    }
+
+    Py_INCREF(py_session);
+    iter->py_session = py_session;
+    iter->ss = ss;
+    iter->table_info = table_info;
+    iter->py_rows = PyList_New(0);
+    iter->next_row = 0;
+    iter->running = 1;
+    table_walk_init(table_info, max_repeaters);
+    if (!iter->py_rows) {
+        Py_DECREF(iter);
+        return NULL;
+    }
+    return (PyObject*) iter;
+}
+
+static void table_iter_dealloc(table_iter_t* iter) {
+    if (iter->table_info) {
+        table_walk_finish(iter->table_info);
+        table_deallocate(iter->table_info);
+    }
+    Py_XDECREF(iter->py_rows);
+    Py_XDECREF(iter->py_session);
+    PyObject_Del(iter);
+}
+
+/* Walk on until there are completed rows to hand out, or the walk has ended. */
+static int table_iter_fill(table_iter_t* iter) {
+    int tmp_dont_breakdown_oids;
+    int exitval;
+    int nr_of_rows = 0;
+
+    if (PyList_SetSlice(iter->py_rows, 0, PyList_GET_SIZE(iter->py_rows), NULL) < 0)
+        return -1;
+    iter->next_row = 0;
+
+    /* same output format as table_getbulk_sub_entries */
+    tmp_dont_breakdown_oids = netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS, 0);
+
+    while (iter->running && nr_of_rows == 0) {
+        exitval = table_walk_step(iter->table_info, iter->ss, iter->py_session, NULL,
+                &iter->running);
+        if (PyErr_Occurred()) {
+            nr_of_rows = -1;
+            iter->running = 0;
+            break;
+        }
+        if (exitval != SUCCESS && exitval != FAILURE)
+            DBPRT(D_DBG, ("table_iter_fill: walk stopped with error response\n"));
+
+        /* a walk that stopped early hands out what it has, as a fetch does */
+        nr_of_rows = table_walk_complete_rows(iter->table_info, iter->py_rows, !iter->running);
+    }
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS, tmp_dont_breakdown_oids);
+
+    if (!iter->running)
+        table_walk_finish(iter->table_info);
+    return nr_of_rows < 0 ? -1 : 0;
+}
+
+static PyObject* table_iter_next(table_iter_t* iter) {
+    PyObject* py_row;
+
+    if (iter->next_row >= PyList_GET_SIZE(iter->py_rows)) {
+        if (!iter->running || table_iter_fill(iter) < 0)
+            return NULL;
+        if (iter->next_row >= PyList_GET_SIZE(iter->py_rows))
+            return NULL; // walk ended, StopIteration
+    }
+
+    /* hand the list's reference over, so the row is freed as soon as the caller is done with it */
+    py_row = PyList_GET_ITEM(iter->py_rows, iter->next_row);
+    Py_INCREF(Py_None);
+    PyList_SET_ITEM(iter->py_rows, iter->next_row, Py_None);
+    iter->next_row++;
+    return py_row;
+}
+
+PyTypeObject TableIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "netsnmptable.interface.TableIterator",  /* tp_name */
+    sizeof(table_iter_t),                    /* tp_basicsize */
+    0,                                       /* tp_itemsize */
+    (destructor) table_iter_dealloc,         /* tp_dealloc */
+    0,                                       /* tp_print */
+    0,                                       /* tp_getattr */
+    0,                                       /* tp_setattr */
+    0,                                       /* tp_compare */
+    0,                                       /* tp_repr */
+    0,                                       /* tp_as_number */
+    0,                                       /* tp_as_sequence */
+    0,                                       /* tp_as_mapping */
+    0,                                       /* tp_hash */
+    0,                                       /* tp_call */
+    0,                                       /* tp_str */
+    0,                                       /* tp_getattro */
+    0,                                       /* tp_setattro */
+    0,                                       /* tp_as_buffer */
+    Py_TPFLAGS_DEFAULT,                      /* tp_flags */
+    "Row by row SNMP table walk, yields (index tuple, row dict).", /* tp_doc */
+    0,                                       /* tp_traverse */
+    0,                                       /* tp_clear */
+    0,                                       /* tp_richcompare */
+    0,                                       /* tp_weaklistoffset */
+    PyObject_SelfIter,                       /* tp_iter */
+    (iternextfunc) table_iter_next,          /* tp_iternext */
+};
@@ -0,0 +1,26 @@
+#ifndef ITERATOR_H_
+#define ITERATOR_H_
+
+#include <Python.h>
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include "util.h"
+#include "table.h"
+
+/* row by row table walk, one getbulk round trip whenever the completed rows are used up */
+typedef struct table_iter_s {
+    PyObject_HEAD
+    PyObject* py_session;     // keeps the session pointer valid, receives error attributes
+    void* ss;
+    table_info_t* table_info; // private copy, so the Table can be used while iterating
+    PyObject* py_rows;        // completed rows of the most recent response, list of (index tuple, row dict)
+    Py_ssize_t next_row;
+    int running;
+} table_iter_t;
+
+extern PyTypeObject TableIterType;
+
+extern PyObject* table_iter_new(PyObject* py_session, void* ss, table_info_t* table_info,
+        int max_repeaters);
+
+#endif /* ITERATOR_H_ */
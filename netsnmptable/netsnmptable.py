@@ -7,16 +7,93 @@ def create_from_mib(self, conceptual_table_name):
     table._parse_mib(netsnmp.Varbind(conceptual_table_name, 0))
     return table
 
+def create_from_schema_file(self, path):
+    """Create a table query object from a schema file written by Table.save_schema.
+    No MIB is needed, so processes may skip MIB loading entirely, e.g. with environment
+    variables MIBS and MIBDIRS set empty. Values of enum columns are shown as numbers then,
+    even with UseEnums.
+    """
+    with open(path, "rb") as f:
+        data = f.read()
+    table = Table(self)
+    table._tbl_ptr = interface.table_load_schema(table, data)
+    return table
+
+def create_from_schema(self, root_oid, columns, indexes):
+    """Create a table query object from an explicit definition, see Table.from_schema."""
+    return Table.from_schema(self, root_oid, columns, indexes)
+
+def create_group(self, tables):
+    """Create a query object for tables with the same indexes, see TableGroup.
+    tables may be given as Table objects or as conceptual table names for table_from_mib.
+    """
+    return TableGroup([self.table_from_mib(t) if isinstance(t, str) else t for t in tables])
+
 class Table(object):
     def __init__(self, session):
         self.max_repeaters = 10
+        self.adaptive_repeaters = False
+        self.value_mode = "varbind"
+        self.layout = "rows"
+        self.fetch_columns = None
+        self.row_filter = None
+        self.fetch_scalars = None
+        self.scalar_values = None
+        self.resume_cursor = None
+        self.cursor = None
+        self.end_iid = None
+        self.collect_stats = False
+        self.stats = None
+        self.record_capture = False
+        self.replay_capture = None
+        self.capture = None
         self.start_index_oid = []
         self.indexes = []
         self.columns = []
         self.netsnmp_session = session
         self._tbl_ptr = None
 
-    def get_entries(self, iid=None, max_repeaters=10):
+    @classmethod
+    def from_schema(cls, session, root_oid, columns, indexes):
+        """Create a table query object from an explicit definition, without any MIB.
+
+        Args:
+            session:  netsnmp.Session to query.
+            root_oid: OID of the conceptual table, as dotted string or list of integers.
+                      Conceptual rows are expected at root_oid.1, as RFC 4181 requires.
+                      Example: ".1.3.6.1.2.1.2.2" for IF-MIB::ifTable
+            columns:  Dictionary that maps column sub-identifiers to (name, syntax) tuples.
+                      syntax is a type name as netsnmp.Varbind shows it, e.g. "INTEGER", "OCTETSTR",
+                      "COUNTER", "GAUGE", "TICKS", "COUNTER64", "IPADDR" or "OBJECTID".
+                      With None, the type is taken from each response varbind.
+                      Example: {2: ("ifDescr", "OCTETSTR"), 10: ("ifInOctets", "COUNTER")}
+            indexes:  List of index syntax names, outermost first. A fixed length OCTET STRING is
+                      given as tuple ("OCTETSTR", length), an IMPLIED index with the prefix "IMPLIED ".
+                      Example: ["INTEGER"] for ifTable, ["OCTETSTR", "IMPLIED OBJECTID"]
+
+        Returns:
+            A Table, which works like one created from MIB. Values of enum columns are shown
+            as numbers, even with UseEnums.
+        """
+        if isinstance(root_oid, str):
+            root_oid = [int(subid) for subid in root_oid.strip(".").split(".")]
+        index_specs = []
+        for index in indexes:
+            fixed_len = 0
+            if isinstance(index, tuple):
+                index, fixed_len = index
+            implied = index.startswith("IMPLIED ")
+            if implied:
+                index = index[len("IMPLIED "):]
+            index_specs.append((index, fixed_len, implied))
+        column_specs = [(subid, name, syntax) for subid, (name, syntax) in sorted(columns.items())]
+        table = cls(session)
+        table._tbl_ptr = interface.table_from_schema(table, list(root_oid) + [1], column_specs, index_specs)
+        return table
+
+    def get_entries(self, iid=None, max_repeaters=10, value_mode="varbind", columns=None, adaptive=False,
+                    layout="rows", resume=None, end_iid=None, stats=False, record=None, replay=None,
+                    scalars=None, where=None):
         """Get entries from a SNMP table, or parts of a table.
 
         All information required to query a table is taken from MIB.
@@ -29,8 +106,68 @@ class Table(object):
                      If not None, the underlying getbulk/getnext requests will be started like
                      getbulk(<parent>.<entry>.<column_1>[.<iid_1>...<iid_m>],
                              <parent>.<entry>.<column_n>[.<iid_1>...<iid_m>],
+            end_iid: Instance ID as list of integers, the last instance to fetch. Rows beyond it are not
+                     requested, the walk stops as soon as every column has passed it. It may be a prefix
+                     of complete indexes, to include all instances starting with it.
+                     With end_iid, iid is the first instance of the range instead of a prefix.
+                     Example: iid=[1000], end_iid=[1100] on ifTable fetches ifIndex 1000 to 1100.
             max_repeaters: Number of conceptual column instances which are transfered at once in a getbulk response.
                            Adjust this to the number of expected rows to make the query more efficient.
+                           SNMPv1 sessions walk with getnext requests instead, one instance per column
+                           and request, and ignore max_repeaters and adaptive. See get_entries_striped
+                           to speed up such walks.
+            adaptive: If True, max_repeaters is only the first guess. It grows while responses come back full,
+                      and shrinks to what fits when the agent answers tooBig or truncates a response.
+                      Large tables need fewer round trips this way, without knowing the agent's limits.
+            layout: "rows" returns the dictionary of dictionaries described below.
+                    "columnar" returns a tuple (index, columns) of netsnmptable.ColumnArray objects instead,
+                    without creating any python object per cell or row. Rows are sorted by instance OID.
+                    index holds the instance OID suffix of each row. columns maps each column name
+                    to an array with one element per row, typed int64 (INTEGER), uint64 (Counter32,
+                    Gauge32, TimeTicks, Unsigned32, Counter64), bytes (OCTET STRING, IpAddress, Opaque,
+                    BITS) or oid. Arrays support len(), indexing and the buffer protocol. bytes and oid
+                    arrays carry rows + 1 int64 offsets into their buffer. Each column's valid array
+                    is 1 where the row has a cell of that column. value_mode is ignored.
+            resume: A cursor from a previous call, see Returns. The walk continues where that call stopped,
+                    instead of starting over. Pass the same iid and columns as before. Rows the previous
+                    call returned partially may show up again, with the remaining columns.
+            value_mode: "varbind" stores netsnmp.Varbind objects as cell values, where val is a string.
+                        "native" stores plain python values instead (int/long for numeric types,
+                        str with raw octets for OCTET STRING, IpAddress, Opaque and BITS,
+                        tuple of ints for OBJECT IDENTIFIER, None for NULL and exceptions).
+                        Native mode skips Varbind construction and value formatting, and is
+                        considerably faster on large tables.
+            columns: List of column names to fetch, as found in the columns attribute.
+                     Only these columns are requested from the agent, which reduces PDU size
+                     and processing time roughly in proportion. None fetches all columns.
+            stats:   If True, the stats attribute is set to a dictionary that tells where the time went:
+                     pdus_sent, request_bytes and response_bytes (BER size of the PDUs, without
+                     message header), rtt_histogram as list of (upper bound in ms, count) with
+                     None as last bound, varbinds_received, varbinds_discarded (beyond the end of
+                     the table, range or column), retries, too_big, index_tuples (rows whose index
+                     was decoded), cells_stored (values put into row dictionaries), max_repetitions
+                     (list of the max-repetitions of the first 64 requests, 1 for GETNEXT), and
+                     network_seconds, decode_seconds and materialize_seconds (creating python objects).
+                     Otherwise stats is None. Collecting costs a few clock reads per request.
+            record:  Path of a file to write the responses of this walk to, for replay.
+            replay:  Path of a file written with record. The walk takes its responses from there, in order,
+                     instead of sending requests. Pass the same iid, end_iid, max_repeaters, adaptive and
+                     columns as for recording. Nothing is sent, so the decode path can be profiled without
+                     network jitter. If the capture ends before the walk, it stops as on a timeout.
+            scalars: List of scalar OIDs to get along with the table, as names or dotted strings,
+                     e.g. ["SNMPv2-MIB::sysUpTime.0"]. They ride as non-repeaters in the first getbulk
+                     request of the walk, so the scalars and the first rows come from the same
+                     response, without an extra round trip. The scalar_values attribute is set to a
+                     dictionary that maps each given OID to its value, formatted as cells are
+                     according to value_mode, or None if the agent doesn't have it.
+                     Otherwise scalar_values is None.
+            where:   Condition built from Column objects, only rows that satisfy it are returned, e.g.
+                     (Column("ifOperStatus") == 1) & Column("ifDescr").startswith("eth").
+                     It's evaluated on the raw response varbinds while they are parsed, so rejected
+                     rows never get python objects. Columns it refers to are fetched as well, even
+                     if not in columns, but the rows only contain the columns asked for.
+                     A cell a row doesn't have makes its comparisons false.
+                     Only for layout "rows".
 
         Returns:
             On success, a dictionary of dictionaries is returned.
@@ -38,12 +175,284 @@ class Table(object):
             Inner dictionary takes the conceptual column name as key.
             On error, None is returned, and related netsnmp.Session attributes
             ErrorStr, ErrorNum and ErrorInd are updated.
+            If the walk stopped early, e.g. on a timeout, the rows received so far are returned, and
+            the cursor attribute is set to an opaque value for the resume argument. After a complete
+            walk, cursor is None.
 
         """
+        if value_mode == "rate":
+            raise ValueError("value_mode 'rate' is only supported by Table.poll_rates")
         self.max_repeaters = max_repeaters
-        res = interface.table_fetch(self, iid)
+        self.resume_cursor = resume
+        self.cursor = None
+        self.end_iid = end_iid
+        self.adaptive_repeaters = adaptive
+        self.value_mode = value_mode
+        self.layout = layout
+        self.fetch_columns = columns
+        self.collect_stats = stats
+        self.record_capture = record is not None
+        self.replay_capture = None
+        self.capture = None
+        self.fetch_scalars = scalars
+        self.scalar_values = None
+        self.row_filter = where.spec if where is not None else None
+        if replay is not None:
+            with open(replay, "rb") as f:
+                self.replay_capture = f.read()
+        try:
+            res = interface.table_fetch(self, iid)
+        finally:
+            self.replay_capture = None
+            self.fetch_scalars = None
+            self.row_filter = None
+        if scalars is not None and self.scalar_values is not None:
+            self.scalar_values = dict(zip(scalars, self.scalar_values))
+        if record is not None and self.capture is not None:
+            with open(record, "wb") as f:
+                f.write(self.capture)
+            self.capture = None
         return res
 
+    def iter_entries(self, iid=None, max_repeaters=10, value_mode="varbind", columns=None, adaptive=False,
+                     end_iid=None, where=None):
+        """Get entries from a SNMP table row by row, without building the complete table dictionary.
+
+        Rows are yielded as soon as every column has moved past them, and are not kept afterwards.
+        Memory use is therefore bounded by the rows of about one getbulk response, whatever
+        the size of the table.
+
+        Args:
+            iid, end_iid, max_repeaters, value_mode, columns, adaptive, where: as for get_entries.
+
+        Yields:
+            Tuples (index tuple, row dictionary), in index order. Row dictionaries are the
+            inner dictionaries get_entries would return.
+            On error, iteration stops early, and related netsnmp.Session attributes
+            ErrorStr, ErrorNum and ErrorInd are updated.
+        """
+        self.max_repeaters = max_repeaters
+        self.resume_cursor = None
+        self.end_iid = end_iid
+        self.adaptive_repeaters = adaptive
+        self.value_mode = value_mode
+        self.layout = "rows"
+        self.fetch_columns = columns
+        self.collect_stats = False
+        self.row_filter = where.spec if where is not None else None
+        try:
+            return interface.table_iter(self, iid)
+        finally:
+            self.row_filter = None
+
+    def poll_rates(self, columns, iid=None, max_repeaters=10, adaptive=False, uptime_oid=".1.3.6.1.2.1.1.3.0"):
+        """Poll counter columns, and tell how much each counter grew since the previous poll.
+
+        The previous raw counter values are kept inside the Table object, per column and instance,
+        so a monitoring loop just calls poll_rates repeatedly. Counter32 values which went down
+        have wrapped around once. A Counter64 value which went down, or a restart of the agent,
+        is a discontinuity and starts over. Rows that have gone are forgotten after a complete poll.
+
+        Args:
+            columns: List of column names to poll, as found in the columns attribute. Columns which
+                     are not Counter32 or Counter64 may be included, e.g. to label rows.
+            iid, max_repeaters, adaptive: as for get_entries.
+            uptime_oid: Scalar that tells the agent's uptime in TimeTicks, requested along with the first
+                        rows of each poll. If it went down, the agent restarted and all previous values
+                        are dropped. None skips the check, e.g. if the agent doesn't implement sysUpTime.
+
+        Returns:
+            A dictionary of dictionaries as get_entries returns, where the cells of counter columns
+            are tuples (delta, rate per second). The rate divides by the time between the responses
+            of both polls. Counters without previous value are None. Other cells have native values.
+            On error, None is returned, and related netsnmp.Session attributes
+            ErrorStr, ErrorNum and ErrorInd are updated.
+        """
+        self.max_repeaters = max_repeaters
+        self.resume_cursor = None
+        self.cursor = None
+        self.end_iid = None
+        self.adaptive_repeaters = adaptive
+        self.value_mode = "rate"
+        self.layout = "rows"
+        self.fetch_columns = columns
+        self.collect_stats = False
+        self.record_capture = False
+        self.replay_capture = None
+        # the first scalar of a rate poll is taken as uptime
+        self.fetch_scalars = [uptime_oid] if uptime_oid is not None else None
+        self.scalar_values = None
+        try:
+            res = interface.table_fetch(self, iid)
+        finally:
+            self.fetch_scalars = None
+        if uptime_oid is not None and self.scalar_values is not None:
+            self.scalar_values = dict(zip([uptime_oid], self.scalar_values))
+        return res
+
+    def get_changes(self, iid=None, max_repeaters=10, columns=None, adaptive=False, end_iid=None):
+        """Walk the table, and tell which rows were added, changed or removed since the previous call.
+
+        The Table object retains a snapshot of the previous walk, one 64 bit hash of the raw cell values
+        per row, keyed by instance OID. Python objects are only created for rows that differ from it,
+        so processing is proportional to the churn of mostly static tables, like ARP, routing or
+        LLDP neighbour tables, rather than to their size. The first call reports all rows as added.
+
+        Args:
+            iid, end_iid, max_repeaters, adaptive, columns: as for get_entries. Pass the same values in
+            every call, rows outside of the fetched range or columns would look removed or changed.
+
+        Returns:
+            A tuple (added, changed, removed). added and changed are dictionaries of row dictionaries
+            as get_entries returns them in "native" value_mode, changed rows with all their cells.
+            Cells with exception values are left out. removed is a list of index tuples.
+            On error, or if the walk stopped early, None is returned and the snapshot is kept,
+            so the next call compares against the same rows. Only running out of memory while the
+            snapshot is updated drops it, the next call then reports all rows as added.
+            Related netsnmp.Session attributes ErrorStr, ErrorNum and ErrorInd are updated.
+        """
+        self.max_repeaters = max_repeaters
+        self.resume_cursor = None
+        self.cursor = None
+        self.end_iid = end_iid
+        self.adaptive_repeaters = adaptive
+        self.value_mode = "native"
+        self.layout = "changes"
+        self.fetch_columns = columns
+        self.collect_stats = False
+        self.record_capture = False
+        self.replay_capture = None
+        return interface.table_fetch(self, iid)
+
+    def get_rows(self, indexes, columns=None, value_mode="varbind", max_varbinds=60, stats=False):
+        """Get known rows of a SNMP table exactly, with get requests instead of a walk.
+
+        Index tuples are encoded back into instance OIDs, and one get request asks for up to
+        max_varbinds cells of several rows at once. Neighbouring rows are not transferred.
+
+        Args:
+            indexes: List of index tuples, as used as keys in the result of get_entries.
+                     For tables with a single index, the bare value can be given instead of a tuple.
+                     Example: [('ThisIsRow1', 2), ('ThisIsRow2', 1)]
+            columns, value_mode, stats: as for get_entries.
+            max_varbinds: Number of cells per get request. If the agent answers tooBig,
+                          requests are halved until they fit.
+
+        Returns:
+            A dictionary of dictionaries as get_entries returns it, keyed by the indexes as given.
+            Rows the agent doesn't have are left out, as well as columns a row doesn't have.
+            On error, None is returned, and related netsnmp.Session attributes
+            ErrorStr, ErrorNum and ErrorInd are updated.
+        """
+        self.resume_cursor = None
+        self.end_iid = None
+        self.adaptive_repeaters = False
+        self.value_mode = value_mode
+        self.layout = "rows"
+        self.fetch_columns = columns
+        self.collect_stats = stats
+        return interface.table_get_rows(self, indexes, max_varbinds)
+
+    def get_entries_partitioned(self, boundaries, sessions=None, max_repeaters=10, value_mode="varbind",
+                                columns=None, adaptive=False):
+        """Get entries from a SNMP table by walking several index ranges concurrently.
+
+        A large table is walked as len(boundaries) + 1 independent ranges, each with its own
+        chain of getbulk requests, instead of one long serial chain. This pays off when the
+        round trip time dominates, until the agent saturates.
+
+        Args:
+            boundaries: Sorted list of iids that split the index space. Range i starts at boundaries[i - 1]
+                        and ends before boundaries[i]. The first range starts at the beginning of the
+                        table, the last one ends at its end. split_int_index creates boundaries for
+                        dense integer indexes, like ifIndex.
+            sessions:   List of netsnmp.Session objects to spread the ranges over, e.g. several sessions
+                        to the same agent. Defaults to the table's own session for all ranges.
+            max_repeaters, value_mode, columns, adaptive: as for get_entries.
+
+        Returns:
+            The merged dictionary of dictionaries, as get_entries returns it.
+            On an error response in any range, None is returned, and related netsnmp.Session
+            attributes ErrorStr, ErrorNum and ErrorInd are updated.
+        """
+        if not sessions:
+            sessions = [self.netsnmp_session]
+        starts = [None] + [list(b) for b in boundaries]
+        ends = [_before(b) for b in boundaries] + [[_MAX_SUBID]]
+        poller = Poller()
+        for i in range(len(starts)):
+            poller.add(sessions[i % len(sessions)], self, key=i, iid=starts[i], end_iid=ends[i],
+                       max_repeaters=max_repeaters, value_mode=value_mode, columns=columns,
+                       adaptive=adaptive)
+        results = poller.run()
+        tbldict = {}
+        for i in range(len(starts)):
+            if results[i] is None:
+                return None
+            # rows on a boundary which can't be split exactly are fetched twice
+            for idx, row in results[i].items():
+                tbldict.setdefault(idx, {}).update(row)
+        return tbldict
+
+    def get_entries_striped(self, iid=None, max_repeaters=25, value_mode="varbind", columns=None,
+                            adaptive=False, end_iid=None, max_msg_size=1472, group_size=None):
+        """Get entries from a wide SNMP table by walking groups of columns concurrently.
+
+        Every getbulk request of get_entries carries all columns, so on tables with many columns
+        max_repeaters has to stay small to avoid tooBig, and the walk needs many round trips.
+        Here the columns are split into groups small enough that max_repeaters rows of a group fit
+        into one message. All groups are walked at the same time on the table's session, and the
+        rows are merged by index.
+
+        Args:
+            iid, end_iid, max_repeaters, value_mode, columns, adaptive: as for get_entries.
+                max_repeaters applies per group, and may be much larger than for get_entries.
+            max_msg_size: Message size in bytes the responses must fit in, usually the agent's.
+                          Used to derive group_size.
+            group_size: Number of columns per group. If None, columns are packed into groups whose
+                        max_repeaters rows fit into max_msg_size, with varbind sizes estimated from the
+                        column OIDs, and at least _MIN_GROUP_SIZE columns per group. An agent truncates
+                        a getbulk response that doesn't fit, so an estimate that is too large costs
+                        rows per response, not an error. On SNMPv1 sessions, which walk with one getnext
+                        per column and request, the columns are split into _GETNEXT_PIPELINE groups
+                        instead, to keep that many getnext requests in flight.
+
+        Returns:
+            The merged dictionary of dictionaries, as get_entries returns it.
+            On an error response in any group, None is returned, and related netsnmp.Session
+            attributes ErrorStr, ErrorNum and ErrorInd are updated.
+        """
+        if columns is None:
+            columns = list(self.columns)
+        if group_size is None and self.netsnmp_session.Version == 1:
+            group_size = -(-len(columns) // _GETNEXT_PIPELINE)
+        if group_size is None:
+            groups = _pack_columns(columns, interface.table_column_oids(self),
+                                   (max_msg_size - _PDU_OVERHEAD) // max(1, max_repeaters))
+        else:
+            group_size = max(1, group_size)
+            groups = [columns[i:i + group_size] for i in range(0, len(columns), group_size)]
+        poller = Poller()
+        for i, group in enumerate(groups):
+            poller.add(self.netsnmp_session, self, key=i, iid=iid, end_iid=end_iid,
+                       max_repeaters=max_repeaters, value_mode=value_mode,
+                       columns=group, adaptive=adaptive)
+        tbldict = {}
+        for group in poller.run().values():
+            if group is None:
+                return None
+            for idx, row in group.items():
+                tbldict.setdefault(idx, {}).update(row)
+        return tbldict
+
+    def save_schema(self, path):
+        """Write the table structure parsed from MIB to a file, for create_from_schema_file.
+        The file holds root OID, column sub-identifiers, names and syntax, and index types.
+        """
+        data = interface.table_dump_schema(self)
+        with open(path, "wb") as f:
+            f.write(data)
+
     def _parse_mib(self, varbind):
         """Determine the table structure by parsing the MIB.
         After a successful run, table headers are available in indexes and columns dictionary.
@@ -55,7 +464,192 @@ class Table(object):
             self._tbl_ptr = tbl_ptr
 
     def __del__(self):
-        interface.table_cleanup(self._tbl_ptr)
+        if self._tbl_ptr:
+            interface.table_cleanup(self._tbl_ptr)
+
+class TableGroup(Table):
+    """Tables that share their indexes, fetched together as one table.
+
+    Tables like IF-MIB::ifTable and IF-MIB::ifXTable, whose row AUGMENTS ifEntry, or a table and
+    its extension tables with the same INDEX clause, describe the same rows. A TableGroup walks
+    the columns of all tables in the same getbulk requests, and returns one row dictionary per
+    index with the columns of every table, instead of one walk per table and a join afterwards.
+
+    All methods of Table are available. Column names must be unique across the tables.
+    Values of the columns attribute are the column names of the tables, in the given order.
+    """
+    def __init__(self, tables):
+        """Args:
+            tables: List of Table objects with the same indexes. The session of the first table is used.
+        """
+        Table.__init__(self, tables[0].netsnmp_session if tables else None)
+        self.indexes = list(tables[0].indexes) if tables else []
+        self.columns = [column for table in tables for column in table.columns]
+        self._tbl_ptr = interface.table_group(tables)
+
+class Condition(object):
+    """Row filter for the where argument of Table.get_entries, built from Column comparisons.
+
+    Conditions combine with & (and), | (or) and ~ (not). spec is the nested tuple that is
+    compiled into the C filter.
+    """
+    def __init__(self, spec):
+        self.spec = spec
+
+    def __and__(self, other):
+        return Condition(("and", self.spec, other.spec))
+
+    def __or__(self, other):
+        return Condition(("or", self.spec, other.spec))
+
+    def __invert__(self):
+        return Condition(("not", self.spec))
+
+class Column(object):
+    """Column of a table by name, as found in Table.columns, for building Conditions.
+
+    Comparisons take integers, for any numeric column type, or strings with the raw octets of
+    OCTET STRING, IpAddress or Opaque cells. Comparing a cell with a value of the other kind is false.
+    """
+    def __init__(self, name):
+        self.name = name
+
+    def _compare(self, op, values):
+        return Condition((op, self.name, tuple(values)))
+
+    def __eq__(self, value):
+        return self._compare("==", [value])
+
+    def __ne__(self, value):
+        return self._compare("!=", [value])
+
+    def __lt__(self, value):
+        return self._compare("<", [value])
+
+    def __le__(self, value):
+        return self._compare("<=", [value])
+
+    def __gt__(self, value):
+        return self._compare(">", [value])
+
+    def __ge__(self, value):
+        return self._compare(">=", [value])
+
+    def isin(self, values):
+        """Cell equals one of values."""
+        return self._compare("in", values)
+
+    def startswith(self, prefix):
+        """Octet string cell starts with prefix."""
+        return self._compare("prefix", [prefix])
+
+class _PollTarget(object):
+    """One table walk of a Poller. Attributes are read by interface.table_poll."""
+    def __init__(self, key, session, table, iid, max_repeaters, value_mode, columns, adaptive, layout,
+                 end_iid=None):
+        self.key = key
+        self.session = session
+        self.table = table
+        self.iid = iid
+        self.end_iid = end_iid
+        self.max_repeaters = max_repeaters
+        self.adaptive_repeaters = adaptive
+        self.value_mode = value_mode
+        self.layout = layout
+        self.fetch_columns = columns
+
+class Poller(object):
+    """Walk many tables on many hosts concurrently.
+
+    Each added target keeps one getbulk request outstanding. All targets are served
+    from a single event loop, which runs without holding the GIL.
+    """
+    def __init__(self):
+        self.targets = []
+
+    def add(self, session, table, key=None, iid=None, max_repeaters=10, value_mode="varbind", columns=None,
+            adaptive=False, layout="rows", end_iid=None):
+        """Add a table walk on a session.
+
+        Args:
+            session: netsnmp.Session of the host to query.
+            table:   Table object which defines the table structure. Its own session is not used,
+                     so one Table can be added for many sessions.
+            key:     Identifies the target in the result of run(). Defaults to the tuple (session, table).
+            iid, end_iid, max_repeaters, value_mode, columns, adaptive, layout: as for Table.get_entries.
+        """
+        if key is None:
+            key = (session, table)
+        self.targets.append(_PollTarget(key, session, table, iid, max_repeaters, value_mode, columns,
+                                        adaptive, layout, end_iid))
+
+    def run(self):
+        """Walk all added targets and wait until every walk has ended.
+
+        Returns:
+            A dictionary that maps each target key to the same dictionary of dictionaries
+            Table.get_entries would return. On error, the key maps to None, and the attributes
+            ErrorStr, ErrorNum and ErrorInd of the target's session are updated.
+        """
+        return interface.table_poll(self.targets)
+
+# rough response size model for get_entries_striped: message and PDU headers, and per varbind
+# the column OID, plus a short index and value
+_PDU_OVERHEAD = 60
+_INDEX_SIZE_ESTIMATE = 4
+_VALUE_SIZE_ESTIMATE = 8
+
+# get_entries_striped doesn't split columns finer than this
+_MIN_GROUP_SIZE = 8
+
+# concurrent getnext requests of get_entries_striped on SNMPv1 sessions
+_GETNEXT_PIPELINE = 4
+
+# largest sub-identifier, an end_iid of [_MAX_SUBID] includes every instance
+_MAX_SUBID = 4294967295
+
+def _varbind_size(column_oid):
+    """Estimated BER size of a response varbind of a column."""
+    oid_size = 1 + _INDEX_SIZE_ESTIMATE # first two sub-identifiers share an octet
+    for subid in column_oid[2:]:
+        oid_size += 1
+        while subid > 0x7f:
+            subid >>= 7
+            oid_size += 1
+    # sequence, OID and value, each with tag and a short length
+    return 2 + 2 + oid_size + 2 + _VALUE_SIZE_ESTIMATE
+
+def _pack_columns(columns, column_oids, row_budget):
+    """Split columns into consecutive groups whose varbinds of one row fit into row_budget bytes,
+    with at least _MIN_GROUP_SIZE columns per group."""
+    groups = []
+    size = 0
+    for column in columns:
+        vb_size = _varbind_size(column_oids[column])
+        if groups and (len(groups[-1]) < _MIN_GROUP_SIZE or size + vb_size <= row_budget):
+            groups[-1].append(column)
+            size += vb_size
+        else:
+            groups.append([column])
+            size = vb_size
+    return groups
+
+def _before(iid):
+    """Inclusive end iid for a range that ends before iid. Exact if the last sub-identifier
+    can be decremented, otherwise iid itself is included."""
+    iid = list(iid)
+    if iid and iid[-1] > 0:
+        iid[-1] -= 1
+    return iid
+
+def split_int_index(first, last, n):
+    """Boundaries for get_entries_partitioned, splitting a dense integer index from first to last
+    into n ranges of about equal size.
+    Example: split_int_index(1, 40000, 4) gives [[10001], [20001], [30001]]
+    Returns: List of iids
+    """
+    step = (last - first + 1) / float(n)
+    return [[first + int(round(step * i))] for i in range(1, n)]
 
 def str_to_varlen_iid(index_str):
     """Encodes a string to an variable-length string index iid.
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <string.h>
+#include "oidmap.h"
+
+#define OID_MAP_INITIAL_SIZE 64
+
+/* FNV-1a over the sub-identifiers */
+static unsigned long oid_hash(const oid* key, size_t key_len) {
+    unsigned long hash = 2166136261UL;
+    size_t i;
+
+    for (i = 0; i < key_len; i++) {
+        hash ^= (unsigned long) key[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+void oid_map_init(oid_map_t* map, size_t data_size) {
+    map->slots = NULL;
+    map->size = 0;
+    map->used = 0;
+    map->data_size = data_size;
+}
+
+/*
+ * Release all entries. free_data is called for each payload before its memory is released,
+ * to drop references the payload holds. It may be NULL.
+ */
+void oid_map_clear(oid_map_t* map, void (*free_data)(void* data)) {
+    size_t i;
+
+    if (map->slots) {
+        for (i = 0; i < map->size; i++) {
+            if (map->slots[i].key) {
+                if (free_data)
+                    free_data(map->slots[i].data);
+                free(map->slots[i].key);
+            }
+        }
+        free(map->slots);
+    }
+    map->slots = NULL;
+    map->size = 0;
+    map->used = 0;
+}
+
+static oid_map_entry_t* find_slot(oid_map_entry_t* slots, size_t size,
+        const oid* key, size_t key_len, unsigned long hash) {
+    size_t i = hash & (size - 1);
+
+    while (slots[i].key) {
+        if (slots[i].hash == hash && slots[i].key_len == key_len
+                && memcmp(slots[i].key, key, key_len * sizeof(oid)) == 0) {
+            break;
+        }
+        i = (i + 1) & (size - 1);
+    }
+    return &slots[i];
+}
+
+static int grow(oid_map_t* map) {
+    size_t new_size = map->size ? map->size * 2 : OID_MAP_INITIAL_SIZE;
+    oid_map_entry_t* new_slots = calloc(new_size, sizeof(oid_map_entry_t));
+    size_t i;
+
+    if (!new_slots)
+        return -1;
+
+    for (i = 0; i < map->size; i++) {
+        if (map->slots[i].key) {
+            *find_slot(new_slots, new_size, map->slots[i].key,
+                    map->slots[i].key_len, map->slots[i].hash) = map->slots[i];
+        }
+    }
+    free(map->slots);
+    map->slots = new_slots;
+    map->size = new_size;
+    return 0;
+}
+
+/* Returns the entry for key, or NULL if there is none. */
+oid_map_entry_t* oid_map_find(oid_map_t* map, const oid* key, size_t key_len) {
+    oid_map_entry_t* entry;
+
+    if (!map->used)
+        return NULL;
+
+    entry = find_slot(map->slots, map->size, key, key_len, oid_hash(key, key_len));
+    return entry->key ? entry : NULL;
+}
+
+/*
+ * Returns the entry for key, creating it with a zeroed payload if it doesn't exist yet.
+ * *created tells which case applied. Returns NULL if out of memory.
+ * Entry pointers are only valid until the next insert or remove.
+ */
+oid_map_entry_t* oid_map_insert(oid_map_t* map, const oid* key, size_t key_len, int* created) {
+    unsigned long hash = oid_hash(key, key_len);
+    oid_map_entry_t* entry;
+    size_t key_size = key_len * sizeof(oid);
+
+    *created = 0;
+    if ((map->used + 1) * 2 > map->size && grow(map) < 0)
+        return NULL;
+
+    entry = find_slot(map->slots, map->size, key, key_len, hash);
+    if (entry->key)
+        return entry;
+
+    /* key and payload share one block, payload is aligned to oid size */
+    entry->key = calloc(1, key_size + map->data_size + sizeof(oid));
+    if (!entry->key)
+        return NULL;
+    memcpy(entry->key, key, key_size);
+    entry->key_len = key_len;
+    entry->hash = hash;
+    entry->data = (void*) (entry->key + key_len + 1);
+    map->used++;
+    *created = 1;
+    return entry;
+}
+
+/*
+ * Remove an entry returned by find or insert. The payload must not hold references anymore.
+ * Later entries of the probe sequence are shifted back, so no tombstones are needed.
+ */
+void oid_map_remove(oid_map_t* map, oid_map_entry_t* entry) {
+    size_t mask = map->size - 1;
+    size_t hole = entry - map->slots;
+    size_t i = hole;
+
+    free(entry->key);
+    entry->key = NULL;
+    map->used--;
+
+    for (;;) {
+        size_t home;
+
+        i = (i + 1) & mask;
+        if (!map->slots[i].key)
+            break;
+        home = map->slots[i].hash & mask;
+        /* move entry i into the hole, unless its home slot lies cyclically in (hole, i] */
+        if ((i > hole && (home <= hole || home > i))
+                || (i < hole && (home <= hole && home > i))) {
+            map->slots[hole] = map->slots[i];
+            map->slots[i].key = NULL;
+            hole = i;
+        }
+    }
+}
+
+/*
+ * Remove all entries for which keep returns 0, calling free_data on their payload first.
+ * The remaining entries are rehashed into a fresh slot array, so this is safe while many entries go away.
+ * Returns -1 if out of memory, the map is unchanged then.
+ */
+int oid_map_retain(oid_map_t* map, int (*keep)(oid_map_entry_t* entry, void* ctx), void* ctx,
+        void (*free_data)(void* data)) {
+    oid_map_entry_t* new_slots;
+    size_t i;
+
+    if (!map->used)
+        return 0;
+
+    new_slots = calloc(map->size, sizeof(oid_map_entry_t));
+    if (!new_slots)
+        return -1;
+
+    for (i = 0; i < map->size; i++) {
+        if (!map->slots[i].key)
+            continue;
+        if (keep(&map->slots[i], ctx)) {
+            *find_slot(new_slots, map->size, map->slots[i].key,
+                    map->slots[i].key_len, map->slots[i].hash) = map->slots[i];
+        } else {
+            if (free_data)
+                free_data(map->slots[i].data);
+            free(map->slots[i].key);
+            map->used--;
+        }
+    }
+    free(map->slots);
+    map->slots = new_slots;
+    return 0;
+}
@@ -0,0 +1,33 @@
+#ifndef OIDMAP_H_
+#define OIDMAP_H_
+
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+
+/*
+ * Small hash map keyed on raw OID (suffixes), e.g. the instance part of a response OID.
+ * Open addressing with linear probing. Key and per-entry payload are stored in one allocation.
+ */
+typedef struct oid_map_entry_s {
+    oid* key;          // NULL marks a free slot
+    size_t key_len;
+    unsigned long hash;
+    void* data;        // payload of data_size bytes, zero-initialized on insert
+} oid_map_entry_t;
+
+typedef struct oid_map_s {
+    oid_map_entry_t* slots;
+    size_t size;       // number of slots, power of two
+    size_t used;
+    size_t data_size;
+} oid_map_t;
+
+extern void oid_map_init(oid_map_t* map, size_t data_size);
+extern void oid_map_clear(oid_map_t* map, void (*free_data)(void* data));
+extern oid_map_entry_t* oid_map_find(oid_map_t* map, const oid* key, size_t key_len);
+extern oid_map_entry_t* oid_map_insert(oid_map_t* map, const oid* key, size_t key_len, int* created);
+extern void oid_map_remove(oid_map_t* map, oid_map_entry_t* entry);
+extern int oid_map_retain(oid_map_t* map, int (*keep)(oid_map_entry_t* entry, void* ctx), void* ctx,
+        void (*free_data)(void* data));
+
+#endif /* OIDMAP_H_ */
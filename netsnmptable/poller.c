@@ -0,0 +1,262 @@
+/*
+ * Asynchronous table walks on many hosts.
+ *
+ * Every target keeps exactly one GETBULK request outstanding. All sessions are served from a single
+ * select loop, which runs with the GIL released. The netsnmp callback only parks the response at its
+ * target; response parsing and the next request happen afterwards, with the GIL held.
+ */
+
+#include <Python.h>
+#include <sys/select.h>
+#include "poller.h"
+#include "columnar.h"
+
+static int poll_callback(int operation, netsnmp_session *sp, int reqid,
+        netsnmp_pdu *pdu, void *magic) {
+    poll_target_t* target = (poll_target_t*) magic;
+
+    if (!target->outstanding || reqid != target->reqid) {
+        DBPRT(D_DBG, ("poll_callback: stale request %d\n", reqid));
+        return 1;
+    }
+
+    target->outstanding = 0;
+    if (operation == NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE) {
+        /* pdu is freed by netsnmp when we return */
+        target->response = snmp_clone_pdu(pdu);
+        target->status = target->response ? STAT_SUCCESS : STAT_ERROR;
+    } else if (operation == NETSNMP_CALLBACK_OP_TIMED_OUT) {
+        target->status = STAT_TIMEOUT;
+    } else {
+        target->status = STAT_ERROR;
+    }
+    return 1;
+}
+
+static void set_error(poll_target_t* target, const char* err_str, int err_num, int err_ind) {
+    strlcpy(target->err_str, err_str ? err_str : "", STR_BUF_SIZE);
+    target->err_num = err_num;
+    target->err_ind = err_ind;
+}
+
+static void set_session_error(poll_target_t* target) {
+    char *tmp_err_str = NULL;
+    int err_num = 0, err_ind = 0;
+
+#ifdef NETSNMP_SINGLE_API
+    snmp_sess_error(target->ss, &err_num, &err_ind, &tmp_err_str);
+#else
+    snmp_error((netsnmp_session*) target->ss, &err_num, &err_ind, &tmp_err_str);
+#endif
+    set_error(target, tmp_err_str, err_num, err_ind);
+    free(tmp_err_str);
+}
+
+/* Walk finished or failed. A walk that got an error response has no result. */
+static void finish(poll_target_t* target, int failed) {
+    target->done = 1;
+    if (failed) {
+        Py_CLEAR(target->py_table_dict);
+    } else if (target->table_info->layout == LAYOUT_COLUMNAR) {
+        Py_CLEAR(target->py_table_dict);
+        target->py_table_dict = columnar_result(target->table_info);
+    }
+    table_walk_finish(target->table_info);
+}
+
+static void send_next(poll_target_t* target) {
+    netsnmp_pdu* pdu = table_walk_request(target->table_info);
+
+    if (!pdu) {
+        finish(target, 0);
+        return;
+    }
+    target->response = NULL;
+    target->status = STAT_SUCCESS;
+    target->outstanding = 1;
+#ifdef NETSNMP_SINGLE_API
+    target->reqid = snmp_sess_async_send(target->ss, pdu, poll_callback, target);
+#else
+    target->reqid = snmp_async_send((netsnmp_session*) target->ss, pdu, poll_callback, target);
+#endif
+    if (!target->reqid) {
+        DBPRT(D_ERR, ("send_next: async send failed\n"));
+        snmp_free_pdu(pdu);
+        set_session_error(target);
+        target->outstanding = 0;
+        finish(target, 0);
+    }
+}
+
+static void handle_response(poll_target_t* target) {
+    netsnmp_pdu* response = target->response;
+
+    target->response = NULL;
+    if (target->status == STAT_SUCCESS) {
+        if (response->errstat == SNMP_ERR_NOERROR) {
+            switch (table_walk_response(target->table_info, response, target->py_table_dict)) {
+            case WALK_CONTINUE:
+                send_next(target);
+                break;
+            case WALK_DONE:
+                finish(target, 0);
+                break;
+            default:
+                /* out of memory or a python exception, see poller_run */
+                finish(target, 1);
+                break;
+            }
+        } else if (response->errstat == SNMP_ERR_NOSUCHNAME) {
+            /* end of mib the old SNMPv1 way, for one column or all */
+            if (table_walk_no_such_name(target->table_info, response))
+                send_next(target);
+            else
+                finish(target, 0);
+        } else if (response->errstat == SNMP_ERR_TOOBIG && table_walk_too_big(target->table_info)) {
+            send_next(target);
+        } else {
+            set_error(target, snmp_errstring(response->errstat),
+                    (int) response->errstat, (int) response->errindex);
+            finish(target, 1);
+        }
+    } else {
+        if (target->status == STAT_TIMEOUT) {
+            DBPRT(D_DBG, ("Timeout: No Response from peer.\n"));
+            set_error(target, snmp_api_errstring(SNMPERR_TIMEOUT), 0, SNMPERR_TIMEOUT);
+        } else {
+            set_session_error(target);
+        }
+        /* keep partial result, as a synchronous fetch does */
+        finish(target, 0);
+    }
+
+    if (response)
+        snmp_free_pdu(response);
+}
+
+/*
+ * Block until at least one outstanding request got a response or timed out.
+ * Must be called without holding the GIL. sessions contains each session once.
+ */
+static void wait_for_responses(void** sessions, int nr_of_sessions) {
+    struct timeval timeout;
+    int numfds = 0;
+    int block = 1;
+    int count;
+#ifdef NETSNMP_SINGLE_API
+    netsnmp_large_fd_set fdset;
+    int i;
+
+    /* large fd sets, because many sessions easily exceed FD_SETSIZE */
+    netsnmp_large_fd_set_init(&fdset, FD_SETSIZE);
+    timerclear(&timeout);
+    for (i = 0; i < nr_of_sessions; i++) {
+        snmp_sess_select_info2(sessions[i], &numfds, &fdset, &timeout, &block);
+    }
+    count = netsnmp_large_fd_set_select(numfds, &fdset, NULL, NULL, block ? NULL : &timeout);
+    for (i = 0; i < nr_of_sessions; i++) {
+        if (count > 0)
+            snmp_sess_read2(sessions[i], &fdset);
+        /* handles retries and calls back on final timeouts */
+        snmp_sess_timeout(sessions[i]);
+    }
+    netsnmp_large_fd_set_cleanup(&fdset);
+#else
+    fd_set fdset;
+
+    FD_ZERO(&fdset);
+    timerclear(&timeout);
+    snmp_select_info(&numfds, &fdset, &timeout, &block);
+    count = select(numfds, &fdset, NULL, NULL, block ? NULL : &timeout);
+    if (count > 0)
+        snmp_read(&fdset);
+    snmp_timeout();
+#endif
+}
+
+static int compare_ptr(const void* a, const void* b) {
+    const char* pa = *(const char* const*) a;
+    const char* pb = *(const char* const*) b;
+    return (pa > pb) - (pa < pb);
+}
+
+/* A python exception fails every walk that is still running, their next responses are only dropped. */
+static void abort_walks(poll_target_t* targets, int nr_of_targets) {
+    int i;
+
+    for (i = 0; i < nr_of_targets; i++) {
+        if (!targets[i].done)
+            finish(&targets[i], 1);
+    }
+}
+
+/*
+ * Walk all targets concurrently until every walk has ended.
+ * On return, each target has its result in py_table_dict (NULL on error response), and its error info set.
+ * If a python exception is raised, the remaining walks stop at once, and it's still set on return.
+ */
+void poller_run(poll_target_t* targets, int nr_of_targets) {
+    void** sessions;
+    int nr_of_sessions;
+    int outstanding;
+    int tmp_dont_breakdown_oids;
+    int i;
+
+    sessions = calloc(nr_of_targets > 0 ? nr_of_targets : 1, sizeof(void*));
+    if (!sessions) {
+        PyErr_NoMemory();
+        return;
+    }
+
+    /* same output format as table_getbulk_sub_entries */
+    tmp_dont_breakdown_oids = netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS, 0);
+
+    for (i = 0; i < nr_of_targets; i++) {
+        table_walk_init(targets[i].table_info, targets[i].max_repeaters);
+        targets[i].done = 0;
+        set_error(&targets[i], "", 0, 0);
+        send_next(&targets[i]);
+    }
+
+    /* each session only once, several tables may be walked on the same session */
+    for (i = 0; i < nr_of_targets; i++) {
+        sessions[i] = targets[i].ss;
+    }
+    qsort(sessions, nr_of_targets, sizeof(void*), compare_ptr);
+    for (i = 0, nr_of_sessions = 0; i < nr_of_targets; i++) {
+        if (nr_of_sessions == 0 || sessions[nr_of_sessions - 1] != sessions[i])
+            sessions[nr_of_sessions++] = sessions[i];
+    }
+
+    for (;;) {
+        outstanding = 0;
+        for (i = 0; i < nr_of_targets; i++) {
+            outstanding += targets[i].outstanding;
+        }
+        if (!outstanding)
+            break;
+
+        Py_BEGIN_ALLOW_THREADS
+        wait_for_responses(sessions, nr_of_sessions);
+        Py_END_ALLOW_THREADS
+
+        for (i = 0; i < nr_of_targets; i++) {
+            if (!targets[i].done && !targets[i].outstanding) {
+                handle_response(&targets[i]);
+                if (PyErr_Occurred())
+                    abort_walks(targets, nr_of_targets);
+            } else if (targets[i].done && targets[i].response) {
+                /* outstanding when the run was aborted, the callback must not outlive the targets */
+                snmp_free_pdu(targets[i].response);
+                targets[i].response = NULL;
+            }
+        }
+    }
+
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS, tmp_dont_breakdown_oids);
+    free(sessions);
+}
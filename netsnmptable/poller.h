@@ -0,0 +1,30 @@
+#ifndef POLLER_H_
+#define POLLER_H_
+
+#include <Python.h>
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include "util.h"
+#include "table.h"
+
+/* one table walk on one host - one per (session, table) pair */
+typedef struct poll_target_s {
+    void* ss;                    // netsnmp session pointer
+    table_info_t* table_info;    // private copy, request state advances independently of other targets
+    int max_repeaters;
+    PyObject* py_table_dict;     // result, filled while the walk progresses, NULL after an error response
+    // request tracking, written by the netsnmp callback
+    int reqid;
+    int outstanding;
+    int status;
+    netsnmp_pdu* response;
+    // walk result
+    int done;
+    char err_str[STR_BUF_SIZE];
+    int err_num;
+    int err_ind;
+} poll_target_t;
+
+extern void poller_run(poll_target_t* targets, int nr_of_targets);
+
+#endif /* POLLER_H_ */
@@ -0,0 +1,162 @@
+/*
+ * Table schema cache.
+ *
+ * A table structure parsed from MIB is written to a small binary blob, and read back without
+ * loading any MIB. See schema.h for the format.
+ */
+
+#include <Python.h>
+#include "schema.h"
+
+static void put_str(byte_buf_t* buf, const char* str, size_t len) {
+    __buf_put_u32(buf, (uint32_t) len);
+    __buf_put_bytes(buf, str, len);
+}
+
+/*
+ * Serialize the structure of a parsed table.
+ *
+ * Return value: New reference to a string, NULL with exception set on error.
+ */
+PyObject* schema_dump(table_info_t* table_info) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    byte_buf_t buf = { NULL, 0, 0, 0 };
+    PyObject* py_data = NULL;
+    column_t* column;
+    int col, i;
+
+    /* the format has one conceptual row OID for all columns */
+    for (col = 0; col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        if (column->name_length != table_info->rootlen + 1
+                || memcmp(column->name, table_info->root, table_info->rootlen * sizeof(oid))) {
+            PyErr_SetString(PyExc_ValueError, "the schema of a table group can't be saved");
+            return NULL;
+        }
+    }
+
+    __buf_put_bytes(&buf, SCHEMA_MAGIC, 4);
+    __buf_put_u32(&buf, SCHEMA_VERSION);
+    __buf_put_oid(&buf, table_info->root, table_info->rootlen);
+    if (table_info->table_name)
+        put_str(&buf, table_info->table_name, strlen(table_info->table_name));
+    else
+        put_str(&buf, "", 0);
+
+    __buf_put_u32(&buf, (uint32_t) column_scheme->fields);
+    for (col = 0; col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        __buf_put_u32(&buf, (uint32_t) column->subid);
+        __buf_put_u32(&buf, (uint32_t) (column->is_leaf ? column->type : TYPE_OTHER));
+        put_str(&buf, PyString_AS_STRING(column->py_label_str), PyString_GET_SIZE(column->py_label_str));
+    }
+
+    __buf_put_u32(&buf, (uint32_t) table_info->index_vars_nrof);
+    for (i = 0; i < table_info->index_vars_nrof; i++) {
+        __buf_put_u32(&buf, table_info->index_vars[i].type);
+        __buf_put_u32(&buf, (uint32_t) table_info->index_vars[i].val_len);
+    }
+
+    if (buf.failed)
+        PyErr_NoMemory();
+    else
+        py_data = PyString_FromStringAndSize(buf.data, buf.len);
+    free(buf.data);
+    return py_data;
+}
+
+/*
+ * Create a table structure from data written by schema_dump. No MIB is needed.
+ * Columns have no MIB node, so enums can't be resolved by name.
+ *
+ * Returns NULL with exception set on error.
+ */
+table_info_t* schema_load(const char* data, size_t len) {
+    byte_reader_t rd = { data, len, 0, 0 };
+    table_info_t* table_info = NULL;
+    PyObject* py_label = NULL;
+    const char* magic;
+    const char* str;
+    oid root[MAX_OID_LEN];
+    size_t rootlen;
+    uint32_t version, str_len, fields, nr_of_indexes, subid, type, val_len, i;
+
+    magic = __buf_get_bytes(&rd, 4);
+    if (!magic || memcmp(magic, SCHEMA_MAGIC, 4) != 0) {
+        PyErr_SetString(PyExc_ValueError, "not a table schema");
+        return NULL;
+    }
+    version = __buf_get_u32(&rd);
+    if (version != SCHEMA_VERSION) {
+        PyErr_Format(PyExc_ValueError, "unsupported table schema version %u", (unsigned) version);
+        return NULL;
+    }
+
+    rootlen = __buf_get_oid(&rd, root);
+    if (rd.failed || rootlen == 0)
+        goto corrupt;
+    table_info = table_allocate_oid(root, rootlen);
+    if (!table_info) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    str_len = __buf_get_u32(&rd);
+    str = __buf_get_bytes(&rd, str_len);
+    if (!str)
+        goto corrupt;
+    if (str_len > 0) {
+        table_info->table_name = malloc(str_len + 1);
+        if (!table_info->table_name)
+            goto no_memory;
+        memcpy(table_info->table_name, str, str_len);
+        table_info->table_name[str_len] = '\0';
+    } else if (table_set_oid_name(table_info) < 0) {
+        goto no_memory;
+    }
+
+    fields = __buf_get_u32(&rd);
+    for (i = 0; i < fields && !rd.failed; i++) {
+        subid = __buf_get_u32(&rd);
+        type = __buf_get_u32(&rd);
+        str_len = __buf_get_u32(&rd);
+        str = __buf_get_bytes(&rd, str_len);
+        if (!str)
+            goto corrupt;
+        py_label = PyString_FromStringAndSize(str, str_len);
+        if (!py_label)
+            goto fail;
+        if (table_add_column(table_info, subid, py_label, (int) type) < 0)
+            goto no_memory;
+        Py_CLEAR(py_label);
+    }
+
+    nr_of_indexes = __buf_get_u32(&rd);
+    for (i = 0; i < nr_of_indexes && !rd.failed; i++) {
+        type = __buf_get_u32(&rd);
+        val_len = __buf_get_u32(&rd);
+        if (!rd.failed && table_add_index(table_info, (unsigned char) type, (int) val_len) < 0)
+            goto no_memory;
+    }
+
+    if (rd.failed || rd.pos != rd.len)
+        goto corrupt;
+    if (table_complete_columns(table_info) < 0) {
+        if (table_info->column_scheme.fields == 0)
+            goto corrupt;
+        goto no_memory;
+    }
+    return table_info;
+
+    corrupt:
+    PyErr_SetString(PyExc_ValueError, "corrupt table schema");
+    goto fail;
+
+    no_memory:
+    PyErr_NoMemory();
+
+    fail:
+    Py_XDECREF(py_label);
+    table_deallocate(table_info);
+    return NULL;
+}
@@ -0,0 +1,21 @@
+#ifndef SCHEMA_H_
+#define SCHEMA_H_
+
+#include <Python.h>
+#include <net-snmp/net-snmp-config.h>
+#include <net-snmp/net-snmp-includes.h>
+#include "util.h"
+#include "table.h"
+
+/*
+ * Binary table schema, everything a walk needs from the MIB:
+ * root OID, table name, columns (subid, label, syntax) and indexes (type, fixed length).
+ * All integers are 32 bit in network byte order, strings are prefixed with their length.
+ */
+#define SCHEMA_MAGIC "NSTS"
+#define SCHEMA_VERSION 1
+
+extern PyObject* schema_dump(table_info_t* table_info);
+extern table_info_t* schema_load(const char* data, size_t len);
+
+#endif /* SCHEMA_H_ */
@@ -20,6 +20,10 @@
 #include <arpa/inet.h>
 #include "util.h"
 #include "table.h"
+#include "columnar.h"
+#include "capture.h"
+#include "changes.h"
+#include "filter.h"
 
 #define SUCCESS (0)
 #define FAILURE (-1)
@@ -35,21 +39,39 @@ struct table_tree_pointer {
 };
 
 table_info_t* table_allocate(char* tablename) {
+    oid root[MAX_OID_LEN];
+    size_t rootlen = MAX_OID_LEN;
     table_info_t* table_info;
 
-    table_info = calloc(1, sizeof(table_info_t));
-    if (!table_info)
-        return NULL;
-
-    table_info->rootlen = MAX_OID_LEN;
-
-    if (!snmp_parse_oid(tablename, table_info->root, &table_info->rootlen)) {
+    if (!snmp_parse_oid(tablename, root, &rootlen)) {
         PyErr_SetString(PyExc_RuntimeError,
                 "snmp_parse_oid failed to lookup table in MIB.");
         //original was: snmp_perror(argv[optind]);
         return NULL;
     }
 
+    table_info = table_allocate_oid(root, rootlen);
+    if (!table_info)
+        PyErr_NoMemory();
+    return table_info;
+}
+
+/*
+ * Allocate an empty table structure for the table OID root, without any MIB lookup.
+ * Columns and indexes are added with table_add_column and table_add_index then.
+ */
+table_info_t* table_allocate_oid(oid* root, size_t rootlen) {
+    table_info_t* table_info;
+
+    if (rootlen >= MAX_OID_LEN)
+        return NULL;
+
+    table_info = calloc(1, sizeof(table_info_t));
+    if (!table_info)
+        return NULL;
+
+    memcpy(table_info->root, root, rootlen * sizeof(oid));
+    table_info->rootlen = rootlen;
     table_info->table_name = NULL;
     table_info->column_scheme.column = NULL;
     table_info->column_scheme.fields = 0;
@@ -58,14 +80,158 @@ table_info_t* table_allocate(char* tablename) {
     table_info->column_scheme.position_map = NULL;
     table_info->index_vars = NULL;
     table_info->index_vars_nrof = 0;
+    oid_map_init(&table_info->row_cache, sizeof(row_t));
+    oid_map_init(&table_info->rate_state, sizeof(rate_state_t));
+    oid_map_init(&table_info->snapshot, sizeof(snapshot_t));
 
     return table_info;
 }
 
+/*
+ * Name a table that is not known from MIB by its dotted table OID, the root without the conceptual
+ * row sub-identifier. A name that is already set is kept. Returns FAILURE if out of memory.
+ */
+int table_set_oid_name(table_info_t* table_info) {
+    size_t size, pos = 0;
+    size_t i;
+
+    if (table_info->table_name)
+        return SUCCESS;
+    size = table_info->rootlen * 11 + 2;
+    table_info->table_name = malloc(size);
+    if (!table_info->table_name)
+        return FAILURE;
+    table_info->table_name[0] = '\0';
+    for (i = 0; i + 1 < table_info->rootlen; i++)
+        pos += snprintf(&table_info->table_name[pos], size - pos, ".%lu", (unsigned long) table_info->root[i]);
+    return SUCCESS;
+}
+
+/*
+ * Append a column that is not taken from MIB. type is the column syntax as MIB type (TYPE_INTEGER, ...),
+ * or TYPE_OTHER to take the type from each response varbind. py_label is a borrowed reference.
+ * Returns FAILURE if out of memory.
+ */
+int table_add_column(table_info_t* table_info, oid subid, PyObject* py_label, int type) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    column_t* columns;
+    column_t* column;
+
+    columns = realloc(column_scheme->column, (column_scheme->fields + 1) * sizeof(column_t));
+    if (!columns)
+        return FAILURE;
+    column_scheme->column = columns;
+    column = &columns[column_scheme->fields++];
+    memset(column, 0, sizeof(column_t));
+
+    Py_INCREF(py_label);
+    column->py_label_str = py_label;
+    column->subid = subid;
+    column->selected = 1;
+    column->tp = NULL;
+    column->type = type;
+    column->is_leaf = type != TYPE_OTHER;
+    if (column->is_leaf)
+        __get_type_str(type, column->type_str);
+    return SUCCESS;
+}
+
+/*
+ * Append an index that is not taken from MIB. type is an ASN type as get_table_indexes determines it,
+ * with ASN_PRIVATE set for IMPLIED and fixed length indexes. val_len is the length of fixed length strings.
+ * Returns FAILURE if out of memory.
+ */
+int table_add_index(table_info_t* table_info, unsigned char type, int val_len) {
+    index_scheme_t* index_vars;
+    int i;
+
+    index_vars = realloc(table_info->index_vars, (table_info->index_vars_nrof + 1) * sizeof(index_scheme_t));
+    if (!index_vars)
+        return FAILURE;
+    table_info->index_vars = index_vars;
+    i = table_info->index_vars_nrof++;
+    memset(&index_vars[i].vars, 0x00, sizeof(netsnmp_variable_list));
+    index_vars[i].type = type;
+    index_vars[i].val_len = val_len;
+
+    /* the list may have moved */
+    for (i = 0; i < table_info->index_vars_nrof; i++) {
+        index_vars[i].vars.next_variable =
+                (i + 1 < table_info->index_vars_nrof) ? &index_vars[i + 1].vars : NULL;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Convert a syntax name, as netsnmp.Varbind shows it in its type attribute (INTEGER, OCTETSTR, COUNTER64, ...),
+ * to the MIB type. Returns -1 if the name is unknown.
+ */
+int table_type_from_str(const char* str) {
+    static const int types[] = { TYPE_OBJID, TYPE_OCTETSTR, TYPE_INTEGER, TYPE_INTEGER32, TYPE_UNSIGNED32,
+            TYPE_NETADDR, TYPE_IPADDR, TYPE_COUNTER, TYPE_GAUGE, TYPE_TIMETICKS, TYPE_OPAQUE,
+            TYPE_COUNTER64, TYPE_NULL, TYPE_UINTEGER, TYPE_BITSTRING };
+    char type_str[MAX_TYPE_NAME_LEN];
+    size_t i;
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if (__get_type_str(types[i], type_str) == SUCCESS && !strcmp(type_str, str))
+            return types[i];
+    }
+    return -1;
+}
+
+/*
+ * Set the column OIDs from the conceptual row OID of the table.
+ */
+static void set_column_names(table_info_t* table_info) {
+    column_t* column;
+    int col;
+
+    for (col = 0; col < table_info->column_scheme.fields; col++) {
+        column = &table_info->column_scheme.column[col];
+        memcpy(column->name, table_info->root, table_info->rootlen * sizeof(oid));
+        column->name[table_info->rootlen] = column->subid;
+        column->name_length = table_info->rootlen + 1;
+    }
+}
+
+/*
+ * Complete a table structure built with table_add_column. root must end with the conceptual row subid.
+ * Returns FAILURE if there are no columns or out of memory.
+ */
+int table_complete_columns(table_info_t* table_info) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+
+    if (column_scheme->fields == 0)
+        return FAILURE;
+    memcpy(column_scheme->name, table_info->root, table_info->rootlen * sizeof(oid));
+    column_scheme->name_length = table_info->rootlen;
+    set_column_names(table_info);
+    free(column_scheme->position_map);
+    column_scheme->position_map = calloc(column_scheme->fields, sizeof(column_t*));
+    return column_scheme->position_map ? SUCCESS : FAILURE;
+}
+
+static void row_release(void* data) {
+    row_t* row = (row_t*) data;
+    free(row->index);
+    Py_XDECREF(row->py_index_tuple);
+    Py_XDECREF(row->py_row_dict);
+}
+
 void table_deallocate(table_info_t* table) {
     int col;
 
     if (table) {
+        oid_map_clear(&table->row_cache, row_release);
+        oid_map_clear(&table->rate_state, NULL);
+        oid_map_clear(&table->snapshot, NULL);
+        filter_free(table->filter);
+        free(table->scalars);
+        Py_XDECREF(table->py_scalar_values);
+        columnar_deallocate(table->columnar);
+        free(table->decode_buf.cell);
+        free(table->decode_buf.text);
     	if (table->table_name) {
     		free(table->table_name);
     	}
@@ -88,6 +254,193 @@ void table_deallocate(table_info_t* table) {
     }
 }
 
+/*
+ * Create an independent copy of a parsed table structure.
+ * The copy has its own per-column request state, so several walks of the same table can be in progress at once.
+ */
+table_info_t* table_clone(table_info_t* table) {
+    table_info_t* clone;
+    int col, i;
+
+    clone = calloc(1, sizeof(table_info_t));
+    if (!clone)
+        return NULL;
+
+    memcpy(clone, table, sizeof(table_info_t));
+    clone->table_name = NULL;
+    clone->column_scheme.column = NULL;
+    clone->column_scheme.position_map = NULL;
+    clone->index_vars = NULL;
+    clone->columnar = NULL;
+    clone->capture = NULL;
+    clone->filter = NULL;
+    clone->scalars = NULL;
+    clone->nr_of_scalars = 0;
+    clone->py_scalar_values = NULL;
+    clone->rate_uptime_known = 0;
+    memset(&clone->decode_buf, 0, sizeof(decode_buf_t));
+    oid_map_init(&clone->row_cache, sizeof(row_t));
+    oid_map_init(&clone->rate_state, sizeof(rate_state_t));
+    oid_map_init(&clone->snapshot, sizeof(snapshot_t));
+
+    if (table->table_name && !(clone->table_name = strdup(table->table_name)))
+        goto fail;
+
+    if (table->column_scheme.fields > 0) {
+        clone->column_scheme.column = malloc(table->column_scheme.fields * sizeof(column_t));
+        clone->column_scheme.position_map = calloc(table->column_scheme.fields, sizeof(column_t*));
+        if (!clone->column_scheme.column || !clone->column_scheme.position_map) {
+            clone->column_scheme.fields = 0;
+            goto fail;
+        }
+        memcpy(clone->column_scheme.column, table->column_scheme.column,
+                table->column_scheme.fields * sizeof(column_t));
+        for (col = 0; col < clone->column_scheme.fields; col++) {
+            Py_INCREF(clone->column_scheme.column[col].py_label_str);
+        }
+    }
+
+    if (table->index_vars_nrof > 0) {
+        clone->index_vars = malloc(table->index_vars_nrof * sizeof(index_scheme_t));
+        if (!clone->index_vars)
+            goto fail;
+        memcpy(clone->index_vars, table->index_vars,
+                table->index_vars_nrof * sizeof(index_scheme_t));
+        for (i = 0; i < clone->index_vars_nrof; i++) {
+            clone->index_vars[i].vars.next_variable =
+                    (i + 1 < clone->index_vars_nrof) ? &clone->index_vars[i + 1].vars : NULL;
+        }
+    }
+
+    return clone;
+
+    fail:
+    table_deallocate(clone);
+    return NULL;
+}
+
+/*
+ * Tell if two tables have the same index scheme, so their rows can be joined by instance OID suffix.
+ */
+static int same_indexes(table_info_t* a, table_info_t* b) {
+    int i;
+
+    if (a->index_vars_nrof != b->index_vars_nrof)
+        return 0;
+    for (i = 0; i < a->index_vars_nrof; i++) {
+        if (a->index_vars[i].type != b->index_vars[i].type
+                || a->index_vars[i].val_len != b->index_vars[i].val_len)
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * Append "+name" to the table name, for messages about a table group.
+ * Returns 0 if out of memory.
+ */
+static int append_table_name(table_info_t* table_info, const char* name) {
+    size_t len;
+    char* table_name;
+
+    if (!table_info->table_name || !name)
+        return 1;
+    len = strlen(table_info->table_name);
+    table_name = realloc(table_info->table_name, len + strlen(name) + 2);
+    if (!table_name)
+        return 0;
+    table_name[len] = '+';
+    strcpy(&table_name[len + 1], name);
+    table_info->table_name = table_name;
+    return 1;
+}
+
+/*
+ * Combine tables that share their indexes, like ifTable and the ifXTable that AUGMENTS it, into one
+ * table structure. Its columns are the columns of all tables, each with the OID of its own table,
+ * so a walk requests all of them in the same PDUs and builds one row per instance.
+ * The group is a copy, the tables stay usable on their own.
+ *
+ * Return value: New table structure, NULL with exception set on error.
+ */
+table_info_t* table_group(table_info_t** tables, int nr_of_tables) {
+    table_info_t* group;
+    column_scheme_t* column_scheme;
+    column_t* columns;
+    column_t* column;
+    size_t name_len = 0;
+    int fields = 0;
+    int t, col, other;
+
+    if (nr_of_tables < 1) {
+        PyErr_SetString(PyExc_ValueError, "a table group needs at least one table");
+        return NULL;
+    }
+    for (t = 0; t < nr_of_tables; t++) {
+        if (!same_indexes(tables[0], tables[t])) {
+            PyErr_Format(PyExc_ValueError, "%s and %s have different indexes",
+                    TABLE_NAME(tables[0]), TABLE_NAME(tables[t]));
+            return NULL;
+        }
+        fields += tables[t]->column_scheme.fields;
+    }
+
+    group = table_clone(tables[0]);
+    if (!group)
+        return (table_info_t*) PyErr_NoMemory();
+    column_scheme = &group->column_scheme;
+
+    columns = realloc(column_scheme->column, fields * sizeof(column_t));
+    if (!columns)
+        goto nomem;
+    column_scheme->column = columns;
+    for (t = 1; t < nr_of_tables; t++) {
+        for (col = 0; col < tables[t]->column_scheme.fields; col++) {
+            column = &column_scheme->column[column_scheme->fields];
+            memcpy(column, &tables[t]->column_scheme.column[col], sizeof(column_t));
+            Py_INCREF(column->py_label_str);
+            column_scheme->fields++;
+        }
+    }
+    free(column_scheme->position_map);
+    column_scheme->position_map = calloc(fields, sizeof(column_t*));
+    if (!column_scheme->position_map)
+        goto nomem;
+
+    /* cells are stored by column name, so names must tell the tables apart */
+    for (col = 0; col < fields; col++) {
+        for (other = 0; other < col; other++) {
+            if (PyObject_RichCompareBool(column_scheme->column[col].py_label_str,
+                    column_scheme->column[other].py_label_str, Py_EQ) == 1) {
+                PyErr_Format(PyExc_ValueError, "column %s is in more than one table",
+                        PyString_AsString(column_scheme->column[col].py_label_str));
+                goto fail;
+            }
+        }
+    }
+
+    /* index OIDs are limited to what fits behind the longest column OID */
+    for (t = 0; t < nr_of_tables; t++) {
+        if (tables[t]->column_scheme.name_length > name_len) {
+            name_len = tables[t]->column_scheme.name_length;
+            memcpy(column_scheme->name, tables[t]->column_scheme.name, name_len * sizeof(oid));
+        }
+    }
+    column_scheme->name_length = name_len;
+
+    for (t = 1; t < nr_of_tables; t++) {
+        if (!append_table_name(group, tables[t]->table_name))
+            goto nomem;
+    }
+    return group;
+
+    nomem:
+    PyErr_NoMemory();
+    fail:
+    table_deallocate(group);
+    return NULL;
+}
+
 void reverse_fields(column_scheme_t* column_scheme) {
     column_t tmp;
     int i;
@@ -138,12 +491,28 @@ static void get_table_nodes(struct table_tree_pointer* tbl_tree, oid* table_oid,
  */
 static int get_table_indexes(index_scheme_t **index_var, struct table_tree_pointer* tbl_tree) {
     struct index_list *index;
+    struct tree *row = tbl_tree->conceptual_row;
     size_t list_size = sizeof(index_scheme_t);
     int count=0, i=0;
 
     *index_var = NULL;
 
-    for (index = tbl_tree->conceptual_row->indexes; index; index = index->next) {
+    /* no MIB for this table */
+    if (!row)
+        return 0;
+
+    /* a row that AUGMENTS another one, like ifXEntry, has the indexes of that row */
+    if (!row->indexes && row->augments) {
+        oid name[MAX_OID_LEN];
+        size_t name_length = MAX_OID_LEN;
+        if (!snmp_parse_oid(row->augments, name, &name_length) ||
+                (NULL == (row = get_tree(name, name_length, get_tree_head())))) {
+            DBPRT(D_DBG, ("get_table_indexes: Can't get augmented row from MIB.\n"));
+            return -1;
+        }
+    }
+
+    for (index = row->indexes; index; index = index->next) {
         struct tree *indexnode = NULL;
         unsigned char type;
         int length = 0;
@@ -249,6 +618,23 @@ static PyObject* get_column_name(oid* column_oid, size_t oid_len) {
     return py_column_name;
 }
 
+/*
+ * Remember the MIB node of a column, and resolve its type once.
+ * Instances of a column all share the same node, so the response parsing
+ * needs no MIB tree lookup per varbind.
+ */
+static void set_column_node(column_t* column, struct tree* tp) {
+    column->tp = tp;
+    column->is_leaf = __is_leaf(tp);
+    column->type = TYPE_OTHER;
+    column->type_str[0] = '\0';
+    if (column->is_leaf) {
+        column->type = (tp->type ? tp->type : tp->parent->type);
+        __get_type_str(column->type, column->type_str);
+    }
+    DBPRT(D_DBG, ("Column node %p, leaf %d, type %s\n", tp, column->is_leaf, column->type_str));
+}
+
 /*
  * Get table structure information from MIB.
  */
@@ -256,10 +642,11 @@ int table_get_field_names(table_info_t* table_info) {
     struct table_tree_pointer tbl_tree;
     column_scheme_t* column_info = &table_info->column_scheme;
     PyObject* py_col_name = NULL;
+    struct tree *column_node = NULL;
     int going = 1;
 
     get_table_nodes(&tbl_tree, table_info->root, table_info->rootlen);
-    if (tbl_tree.conceptual_row->child_list) {
+    if (tbl_tree.conceptual_row && tbl_tree.conceptual_row->child_list) {
         table_info->root[table_info->rootlen++] = tbl_tree.conceptual_row->subid;
     } else {
         table_info->root[table_info->rootlen++] = 1;
@@ -275,6 +662,7 @@ int table_get_field_names(table_info_t* table_info) {
     column_info->fields = 0;
     while (going) {
         column_info->fields++;
+        column_node = NULL;
 #ifndef NETSNMP_DISABLE_MIB_LOADING
         if (tbl_tree.conceptual_column) {
             if (tbl_tree.conceptual_column->access == MIB_ACCESS_NOACCESS) {
@@ -287,6 +675,7 @@ int table_get_field_names(table_info_t* table_info) {
                 continue;
             } DBPRT(D_DBG, ("Column Found: table_info->root[%lu] = %lu\n", table_info->rootlen, tbl_tree.conceptual_column->subid));
             table_info->root[table_info->rootlen] = tbl_tree.conceptual_column->subid; // store the subid temporarily (gets overwritten in next while iteration)
+            column_node = tbl_tree.conceptual_column;
             tbl_tree.conceptual_column = tbl_tree.conceptual_column->next_peer;
             if (!tbl_tree.conceptual_column)
                 going = 0;
@@ -318,6 +707,8 @@ int table_get_field_names(table_info_t* table_info) {
         DBPRT(D_DBG, ("column[fields - 1].py_label_str = %s\n", col_name));
         column_info->column[column_info->fields - 1].subid =
                 table_info->root[table_info->rootlen];
+        column_info->column[column_info->fields - 1].selected = 1;
+        set_column_node(&column_info->column[column_info->fields - 1], column_node);
     }
     /* end while (going) */
 
@@ -332,6 +723,7 @@ int table_get_field_names(table_info_t* table_info) {
         /* add 0 as innermost suboid */
         column_info->name_length = table_info->rootlen; // + 1;
         DBPRTOID(D_DBG, "Column root OID for getbulk: ", column_info->name, column_info->name_length);
+        set_column_names(table_info);
 
         /* additional index to get column bei number in response */
         column_info->position_map = calloc(column_info->fields,
@@ -341,6 +733,271 @@ int table_get_field_names(table_info_t* table_info) {
     return SUCCESS;
 }
 
+/*
+ * Restrict the following fetches to a subset of columns.
+ * py_names is a sequence of column names, or None to select all columns.
+ * Returns -1 and sets ValueError if a name is not a column of the table.
+ */
+int table_select_columns(table_info_t* table_info, PyObject* py_names) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    PyObject* py_seq;
+    Py_ssize_t i;
+    int col, found;
+
+    for (col = 0; col < column_scheme->fields; col++) {
+        column_scheme->column[col].selected = (py_names == NULL || py_names == Py_None);
+        column_scheme->column[col].filter_only = 0;
+    }
+    if (py_names == NULL || py_names == Py_None)
+        return SUCCESS;
+
+    py_seq = PySequence_Fast(py_names, "columns must be a sequence of column names");
+    if (!py_seq)
+        return FAILURE;
+
+    for (i = 0; i < PySequence_Fast_GET_SIZE(py_seq); i++) {
+        PyObject* py_name = PySequence_Fast_GET_ITEM(py_seq, i);
+        found = 0;
+        for (col = 0; col < column_scheme->fields; col++) {
+            if (PyObject_RichCompareBool(column_scheme->column[col].py_label_str, py_name, Py_EQ) == 1) {
+                column_scheme->column[col].selected = 1;
+                found = 1;
+                break;
+            }
+        }
+        if (!found) {
+            PyObject* py_repr = PyObject_Repr(py_name);
+            PyErr_Format(PyExc_ValueError, "%s is not a column of %s",
+                    py_repr ? PyString_AsString(py_repr) : "?", TABLE_NAME(table_info));
+            Py_XDECREF(py_repr);
+            Py_DECREF(py_seq);
+            return FAILURE;
+        }
+    }
+
+    Py_DECREF(py_seq);
+    return SUCCESS;
+}
+
+/*
+ * Column OIDs by column name, e.g. to estimate the size of varbinds.
+ *
+ * Return value: New reference to a dictionary of OID tuples, NULL with exception set on error.
+ */
+PyObject* table_get_column_oids(table_info_t* table_info) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    column_t* column;
+    PyObject* py_oids = PyDict_New();
+    PyObject* py_oid;
+    size_t i;
+    int col;
+
+    for (col = 0; py_oids && col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        py_oid = PyTuple_New(column->name_length);
+        for (i = 0; py_oid && i < column->name_length; i++) {
+            PyObject* py_subid = PyInt_FromSize_t((size_t) column->name[i]);
+            if (!py_subid) {
+                Py_CLEAR(py_oid);
+                break;
+            }
+            PyTuple_SET_ITEM(py_oid, i, py_subid);  // steals reference to py_subid
+        }
+        if (!py_oid || PyDict_SetItem(py_oids, column->py_label_str, py_oid) < 0)
+            Py_CLEAR(py_oids);
+        Py_XDECREF(py_oid);
+    }
+    return py_oids;
+}
+
+/*
+ * Snapshot of the per-column request state after a walk, to continue it later with table_set_cursor.
+ * The cursor is a tuple with one (column subid, end flag, last OID tuple) entry per column.
+ *
+ * Return value: New reference. None if every column has ended, so there is nothing to continue.
+ */
+PyObject* table_get_cursor(table_info_t* table_info) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    column_t* column;
+    PyObject* py_cursor;
+    PyObject* py_oid;
+    PyObject* py_entry;
+    size_t i;
+    int col;
+
+    for (col = 0; col < column_scheme->fields; col++) {
+        if (!column_scheme->column[col].end)
+            break;
+    }
+    if (col == column_scheme->fields) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+
+    py_cursor = PyTuple_New(column_scheme->fields);
+    for (col = 0; py_cursor && col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        py_oid = PyTuple_New(column->last_oid_len);
+        for (i = 0; py_oid && i < column->last_oid_len; i++) {
+            PyObject* py_subid = PyInt_FromSize_t((size_t) column->last_oid[i]);
+            if (!py_subid) {
+                Py_CLEAR(py_oid);
+                break;
+            }
+            PyTuple_SET_ITEM(py_oid, i, py_subid);  // steals reference to py_subid
+        }
+        py_entry = py_oid ? Py_BuildValue("(kiN)", (unsigned long) column->subid, (int) column->end, py_oid) : NULL;
+        if (!py_entry) {
+            Py_CLEAR(py_cursor);
+            break;
+        }
+        PyTuple_SET_ITEM(py_cursor, col, py_entry);  // steals reference to py_entry
+    }
+    return py_cursor;
+}
+
+/*
+ * Continue the next walk where a previous one stopped, see table_get_cursor.
+ * py_cursor None starts from the beginning as usual.
+ * Returns -1 and sets ValueError if the cursor doesn't belong to this table.
+ */
+int table_set_cursor(table_info_t* table_info, PyObject* py_cursor) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    column_t* column;
+    unsigned long subid;
+    int end;
+    PyObject* py_oid;
+    PyObject* py_entry;
+    size_t oid_len;
+    oid last_oid[MAX_OID_LEN];
+    int col;
+
+    table_info->resume = 0;
+    if (py_cursor == NULL || py_cursor == Py_None)
+        return SUCCESS;
+
+    if (!PyTuple_Check(py_cursor) || PyTuple_GET_SIZE(py_cursor) != column_scheme->fields)
+        goto invalid;
+
+    /* validate everything first, so an invalid cursor leaves the columns untouched */
+    for (col = 0; col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        py_entry = PyTuple_GET_ITEM(py_cursor, col);
+        if (!PyArg_ParseTuple(py_entry, "kiO", &subid, &end, &py_oid)) {
+            PyErr_Clear();
+            goto invalid;
+        }
+        if (subid != column->subid || !PySequence_Check(py_oid)
+                || PySequence_Size(py_oid) < (Py_ssize_t) column->name_length
+                || PySequence_Size(py_oid) > MAX_OID_LEN
+                || py_netsnmp_attr_get_oid(py_oid, last_oid, MAX_OID_LEN, &oid_len) < 0
+                || memcmp(last_oid, column->name, column->name_length * sizeof(oid)))
+            goto invalid;
+    }
+
+    for (col = 0; col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        py_entry = PyTuple_GET_ITEM(py_cursor, col);
+        PyArg_ParseTuple(py_entry, "kiO", &subid, &end, &py_oid);
+        py_netsnmp_attr_get_oid(py_oid, column->last_oid, MAX_OID_LEN, &column->last_oid_len);
+        column->end = (char) (end != 0);
+    }
+    table_info->resume = 1;
+    return SUCCESS;
+
+    invalid:
+    if (PyErr_Occurred())
+        PyErr_Clear();
+    PyErr_Format(PyExc_ValueError, "cursor does not belong to %s", TABLE_NAME(table_info));
+    return FAILURE;
+}
+
+/*
+ * Request scalars along with the first request of the next walks, as non-repeaters of the GETBULK.
+ * py_scalars is a sequence of OIDs as strings, names or dotted numbers, e.g. "SNMPv2-MIB::sysUpTime.0".
+ * None requests no scalars.
+ * Returns -1 with exception set on error.
+ */
+int table_set_scalars(table_info_t* table_info, PyObject* py_scalars) {
+    PyObject* py_seq = NULL;
+    scalar_t* scalar;
+    char* name;
+    int i, n;
+
+    free(table_info->scalars);
+    table_info->scalars = NULL;
+    table_info->nr_of_scalars = 0;
+    if (!py_scalars || py_scalars == Py_None)
+        return SUCCESS;
+
+    py_seq = PySequence_Fast(py_scalars, "scalars must be a sequence of OIDs");
+    if (!py_seq)
+        return FAILURE;
+    n = (int) PySequence_Fast_GET_SIZE(py_seq);
+    if (n > 0 && !(table_info->scalars = calloc(n, sizeof(scalar_t)))) {
+        PyErr_NoMemory();
+        goto fail;
+    }
+
+    for (i = 0; i < n; i++) {
+        scalar = &table_info->scalars[i];
+        name = PyString_AsString(PySequence_Fast_GET_ITEM(py_seq, i));
+        if (!name)
+            goto fail;
+        scalar->name_len = MAX_OID_LEN;
+        if (!snmp_parse_oid(name, scalar->name, &scalar->name_len) || scalar->name_len < 2) {
+            PyErr_Format(PyExc_ValueError, "unknown scalar %s", name);
+            goto fail;
+        }
+
+        /* x.0 directly follows x. Otherwise x.(n-1).<max> comes close before x.n. */
+        memcpy(scalar->request, scalar->name, scalar->name_len * sizeof(oid));
+        scalar->request_len = scalar->name_len;
+        if (scalar->name[scalar->name_len - 1] == 0) {
+            scalar->request_len--;
+        } else {
+            scalar->request[scalar->request_len - 1]--;
+            if (scalar->request_len < MAX_OID_LEN)
+                scalar->request[scalar->request_len++] = 0xffffffffUL;
+        }
+    }
+    table_info->nr_of_scalars = n;
+    Py_DECREF(py_seq);
+    return SUCCESS;
+
+    fail:
+    free(table_info->scalars);
+    table_info->scalars = NULL;
+    Py_DECREF(py_seq);
+    return FAILURE;
+}
+
+/*
+ * Values of the scalars of the most recent walk, see table_set_scalars. A scalar the agent doesn't have
+ * is None. Values are formatted according to value_mode, like cells.
+ *
+ * Return value: New reference to a tuple, or to None if no scalars were requested or no response arrived.
+ */
+PyObject* table_get_scalar_values(table_info_t* table_info) {
+    if (!table_info->py_scalar_values)
+        return Py_BuildValue("");
+    Py_INCREF(table_info->py_scalar_values);
+    return table_info->py_scalar_values;
+}
+
+/*
+ * Tell if an instance OID suffix lies beyond end_idx. end_idx may be a prefix of complete indexes,
+ * all instances starting with it are within the bound then.
+ */
+static int past_end_idx(column_scheme_t* column_scheme, oid* suffix, size_t suffix_len) {
+    if (column_scheme->end_idx_length == 0)
+        return 0;
+    if (suffix_len > column_scheme->end_idx_length)
+        suffix_len = column_scheme->end_idx_length;
+    return snmp_oid_compare(suffix, suffix_len, column_scheme->end_idx,
+            column_scheme->end_idx_length) > 0;
+}
+
 static column_t* get_column_validated(table_info_t* table_info,
         netsnmp_variable_list *vars, int nr_in_response) {
     column_t* column = table_info->column_scheme.position_map[nr_in_response];
@@ -348,22 +1005,24 @@ static column_t* get_column_validated(table_info_t* table_info,
     if (vars->type == SNMP_ENDOFMIBVIEW) {
         DBPRT(D_DBG, ("Returned varbinding is end of MIB.\n"));
         return NULL;
-    } else if (memcmp(vars->name, table_info->column_scheme.name,
-            table_info->rootlen * sizeof(oid)) != 0) {
-        DBPRT(D_DBG, ("Returned varbinding does not belong to our table.\n")); DBPRTOID(D_DBG, " varbind:     ", vars->name, table_info->rootlen); DBPRTOID(D_DBG, " header name: ", table_info->column_scheme.name, table_info->rootlen);
+    } else if (vars->name_length <= column->name_length
+            || memcmp(vars->name, column->name, column->name_length * sizeof(oid)) != 0) {
+        DBPRT(D_DBG, ("Returned varbinding is not a instance of expected column.\n"));
+        DBPRTOID(D_DBG, " varbind:     ", vars->name, vars->name_length);
+        DBPRTOID(D_DBG, " column name: ", column->name, column->name_length);
         return NULL;
-    } else if (vars->name[table_info->column_scheme.name_length]
-            != column->subid) {
-        DBPRT(D_DBG, ("Returned varbinding is not a instance of expected column (%lu vs %lu).\n",
-                        (long) vars->name[table_info->column_scheme.name_length],
-                        (long) column->subid));
-        return NULL;
-    } else if (memcmp(&vars->name[table_info->column_scheme.name_length + 1],
+    } else if (table_info->column_scheme.end_idx_length == 0
+            && (vars->name_length - column->name_length < table_info->column_scheme.start_idx_length
+            || memcmp(&vars->name[column->name_length],
             table_info->column_scheme.start_idx,
-            table_info->column_scheme.start_idx_length * sizeof(oid)) != 0) {
+            table_info->column_scheme.start_idx_length * sizeof(oid)) != 0)) {
         DBPRT(D_DBG, ("Returned varbinding does not have requested index.\n"));
         DBPRTOID(D_DBG, " Expected: ", table_info->column_scheme.start_idx, table_info->column_scheme.start_idx_length);
-        DBPRTOID(D_DBG, " Actual  : ", (oid*)(vars->name + table_info->column_scheme.name_length + 1), table_info->column_scheme.start_idx_length);
+        DBPRTOID(D_DBG, " Actual  : ", (oid*)(vars->name + column->name_length), table_info->column_scheme.start_idx_length);
+        return NULL;
+    } else if (past_end_idx(&table_info->column_scheme, &vars->name[column->name_length],
+            vars->name_length - column->name_length)) {
+        DBPRT(D_DBG, ("Returned varbinding is beyond the end index.\n"));
         return NULL;
     }
     return column;
@@ -390,15 +1049,22 @@ int get_nr_of_subidx(oid* start, int max_oid_len, index_scheme_t *index_varlist,
 }
 
 /*
- * Parse index values from a response oid, and create a python tuple from it.
- * This tuple will be used as key in the table dictionary later.
+ * Parse index values from a response oid into plain C values, see index_value_t.
+ * Uses the shared index_varlist as scratch buffer. Doesn't need the GIL.
  *
- * Return value: New reference.
+ * *out is set to a malloc'ed array of nr_of_index values, followed by their octets and sub-identifiers,
+ * or to NULL if the oid doesn't match the indexes.
+ * Returns FAILURE if out of memory.
  */
-PyObject* create_index_tuple(oid* start, int max_oid_len, index_scheme_t *index_varlist, int nr_of_index) {
-    int count = 0;
+static int decode_index(oid* start, int max_oid_len, index_scheme_t *index_varlist, int nr_of_index,
+        index_value_t** out) {
     netsnmp_variable_list *index_var = NULL;
-    PyObject* py_instance_tuple = PyTuple_New(nr_of_index);
+    index_value_t* index = NULL;
+    char* data = NULL;
+    size_t data_len = 0;
+    int count;
+
+    *out = NULL;
 
     /* restore index information, because parse_oid_indexes overwrites some values in buffer */
     for (count=0; count<nr_of_index; count++) {
@@ -408,16 +1074,25 @@ PyObject* create_index_tuple(oid* start, int max_oid_len, index_scheme_t *index_
 
     if (parse_oid_indexes(start, max_oid_len, &index_varlist[0].vars)) {
         DBPRT(D_DBG, ("parse_oid_indexes failed.\n"));
-        return NULL;
+        return SUCCESS;
     }
 
+    /* keep the object identifiers aligned behind the array */
+    for (count = 0; count < nr_of_index; count++)
+        data_len += (index_varlist[count].vars.val_len + sizeof(oid) - 1) / sizeof(oid) * sizeof(oid);
+    index = malloc(nr_of_index * sizeof(index_value_t) + data_len + 1);
+    if (index)
+        data = (char*) (index + nr_of_index);
+    data_len = 0;
+
     for (count = 0; count < nr_of_index; count++) {
         index_var = &index_varlist[count].vars;
-        PyObject* py_subinstance = NULL;
-        char buf[MAX_OID_LEN*21];
-        char *cur = buf, *const end = buf + sizeof(buf);
-        int nrof = 0;
-        int i;
+        if (index) {
+            index[count].type = index_var->type;
+            index[count].integer = 0;
+            index[count].start = data_len;
+            index[count].len = 0;
+        }
 
         switch (index_var->type) {
         case ASN_INTEGER:
@@ -425,71 +1100,233 @@ PyObject* create_index_tuple(oid* start, int max_oid_len, index_scheme_t *index_
         case ASN_TIMETICKS:
         case ASN_COUNTER:
         case ASN_UINTEGER:
-            /* index value will be an integer on python side */
-            py_subinstance = PyInt_FromLong(*index_var->val.integer);
+            if (index)
+                index[count].integer = *index_var->val.integer;
             break;
 
         case ASN_OBJECT_ID:
         case ASN_PRIV_IMPLIED_OBJECT_ID:
         case ASN_PRIV_INCL_RANGE:
         case ASN_PRIV_EXCL_RANGE:
-            /* index value will be a string on python side, containing dotted numbers like "1.2.3.4" */
-            nrof = index_var->val_len / sizeof(oid);
-            for (i=0; i < nrof; i++) {
-                cur += snprintf(cur, end-cur, "%lu", index_var->val.objid[i]);
-                if (i < (nrof-1)) {
-                    *cur = '.';
-                    cur++;
-                }
-            }
-            *cur = '\0';
-            py_subinstance = PyString_FromStringAndSize((const char *) buf, cur-buf);
-            break;
-
         case ASN_IPADDRESS:
-            /* snmp_build_var_op makes a string for ASN_IPADDRESS, e.g. containing '\x01\x00\xa8\xc0' for 192.168.0.1.
-               Turn it into an IP address string in dotted notation. */
-            py_subinstance = PyString_FromString(inet_ntoa(*(struct in_addr*) index_var->val.string));
+            if (index) {
+                memcpy(data + data_len, index_var->val.string, index_var->val_len);
+                index[count].len = index_var->val_len;
+            }
             break;
 
         case ASN_OPAQUE:
         case ASN_OCTET_STR:
         case ASN_PRIV_IMPLIED_OCTET_STR:
-            /* index value will be a string on python side */
-            py_subinstance = PyString_FromStringAndSize((const char *) index_var->val.string, index_var->val_len);
+            if (index) {
+                memcpy(data + data_len, index_var->val.string, index_var->val_len);
+                index[count].len = index_var->val_len;
+            }
             free(index_var->val.string);
             break;
 
         default:
             break;
         }
-        PyTuple_SetItem(py_instance_tuple, count, py_subinstance);
+        data_len += (index_var->val_len + sizeof(oid) - 1) / sizeof(oid) * sizeof(oid);
+    }
+    /* the octet strings are freed either way */
+    *out = index;
+    return index ? SUCCESS : FAILURE;
+}
+
+/*
+ * Create a python tuple from index values decoded with decode_index.
+ * This tuple will be used as key in the table dictionary later.
+ *
+ * Return value: New reference.
+ */
+static PyObject* index_tuple_from_values(index_value_t* index, int nr_of_index) {
+    const char* data = (const char*) (index + nr_of_index);
+    PyObject* py_instance_tuple = PyTuple_New(nr_of_index);
+    PyObject* py_subinstance;
+    struct in_addr addr;
+    int count;
+
+    if (!py_instance_tuple)
+        return NULL;
+
+    for (count = 0; count < nr_of_index; count++) {
+        const char* value = data + index[count].start;
+        char buf[MAX_OID_LEN*21];
+        char *cur = buf, *const end = buf + sizeof(buf);
+        int nrof = 0;
+        int i;
+
+        py_subinstance = NULL;
+        switch (index[count].type) {
+        case ASN_INTEGER:
+        case ASN_UNSIGNED:
+        case ASN_TIMETICKS:
+        case ASN_COUNTER:
+        case ASN_UINTEGER:
+            /* index value will be an integer on python side */
+            py_subinstance = PyInt_FromLong(index[count].integer);
+            break;
+
+        case ASN_OBJECT_ID:
+        case ASN_PRIV_IMPLIED_OBJECT_ID:
+        case ASN_PRIV_INCL_RANGE:
+        case ASN_PRIV_EXCL_RANGE:
+            /* index value will be a string on python side, containing dotted numbers like "1.2.3.4" */
+            nrof = index[count].len / sizeof(oid);
+            for (i=0; i < nrof; i++) {
+                cur += snprintf(cur, end-cur, "%lu", ((const oid*) value)[i]);
+                if (i < (nrof-1)) {
+                    *cur = '.';
+                    cur++;
+                }
+            }
+            *cur = '\0';
+            py_subinstance = PyString_FromStringAndSize((const char *) buf, cur-buf);
+            break;
+
+        case ASN_IPADDRESS:
+            /* snmp_build_var_op makes a string for ASN_IPADDRESS, e.g. containing '\x01\x00\xa8\xc0' for 192.168.0.1.
+               Turn it into an IP address string in dotted notation. */
+            memset(&addr, 0, sizeof(addr));
+            memcpy(&addr, value, index[count].len < sizeof(addr) ? index[count].len : sizeof(addr));
+            py_subinstance = PyString_FromString(inet_ntoa(addr));
+            break;
+
+        case ASN_OPAQUE:
+        case ASN_OCTET_STR:
+        case ASN_PRIV_IMPLIED_OCTET_STR:
+            /* index value will be a string on python side */
+            py_subinstance = PyString_FromStringAndSize(value, index[count].len);
+            break;
+
+        default:
+            Py_INCREF(Py_None);
+            py_subinstance = Py_None;
+            break;
+        }
+        if (!py_subinstance) {
+            Py_DECREF(py_instance_tuple);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(py_instance_tuple, count, py_subinstance);  // steals reference to py_subinstance
     }
     return py_instance_tuple;
 }
 
 /*
- * Create a python tuple from index_vars, use it as key in py_table_dict.
- * Insert py_varbind into a python dictionary.
+ * Parse index values from a response oid, and create a python tuple from it.
+ * This tuple will be used as key in the table dictionary later.
+ *
+ * Return value: New reference. NULL if the oid doesn't match the indexes, or with exception set on error.
+ */
+PyObject* create_index_tuple(oid* start, int max_oid_len, index_scheme_t *index_varlist, int nr_of_index) {
+    index_value_t* index;
+    PyObject* py_instance_tuple;
+
+    if (decode_index(start, max_oid_len, index_varlist, nr_of_index, &index) < 0)
+        return PyErr_NoMemory();
+    if (!index)
+        return NULL;
+    py_instance_tuple = index_tuple_from_values(index, nr_of_index);
+    free(index);
+    return py_instance_tuple;
+}
+
+/*
+ * Find the row a response varbind belongs to.
+ * The instance OID suffix is looked up in the row cache by its raw sub-identifiers.
+ * A new row gets a row number, but no python objects yet, see materialize_row.
+ * Doesn't need the GIL.
  *
- * py_index_tuple and py_varbind are borrowed refrences.
+ * Return value: Pointer into the row cache, stable until the row is removed. NULL if out of memory.
+ */
+static row_t* find_row(table_info_t* table_info, column_t* column, netsnmp_variable_list *vars) {
+    oid* suffix = &vars->name[column->name_length];
+    size_t suffix_len = vars->name_length - column->name_length;
+    oid_map_entry_t* entry;
+    row_t* row;
+    int created;
+
+    entry = oid_map_insert(&table_info->row_cache, suffix, suffix_len, &created);
+    if (!entry)
+        return NULL;
+
+    row = (row_t*) entry->data;
+    if (created)
+        row->nr = table_info->row_cache.used - 1;
+    return row;
+}
+
+/*
+ * Only the first column instance of a row creates the index tuple from the values parsed by
+ * table_walk_decode, creates the row dictionary and inserts it into py_table_dict.
+ * All other columns reuse them.
+ * py_table_dict may be NULL, if rows are taken from the row cache with table_walk_complete_rows.
+ */
+static int materialize_row(table_info_t* table_info, row_t* row, column_t* column,
+        netsnmp_variable_list *vars, PyObject* py_table_dict) {
+    oid* suffix = &vars->name[column->name_length];
+    size_t suffix_len = vars->name_length - column->name_length;
+
+    if (row->py_row_dict)
+        return SUCCESS;
+
+    DBPRT(D_DBG, ("Creating new column dict\n"));
+    if (!row->index && decode_index(suffix, suffix_len, table_info->index_vars,
+            table_info->index_vars_nrof, &row->index) < 0)
+        PyErr_NoMemory();
+    else if (!row->index)
+        PyErr_SetString(PyExc_RuntimeError, "instance OID doesn't match the table indexes");
+    else
+        row->py_index_tuple = index_tuple_from_values(row->index, table_info->index_vars_nrof);
+    row->py_row_dict = PyDict_New();
+    if (!row->py_index_tuple || !row->py_row_dict
+            || (py_table_dict && PyDict_SetItem(py_table_dict, row->py_index_tuple, row->py_row_dict) < 0)) {
+        /* dict is still NULL, a later cell of this row would try again */
+        row_release(row);
+        row->index = NULL;
+        row->py_index_tuple = NULL;
+        row->py_row_dict = NULL;
+        return FAILURE;
+    }
+    if (table_info->collect_stats)
+        table_info->stats.index_tuples++;
+    return SUCCESS;
+}
+
+/*
+ * Record a cell for the columnar layout. The row cache only numbers the rows here,
+ * no index tuple or row dictionary is created. Doesn't need the GIL.
+ * Returns FAILURE if out of memory.
  */
-static int store_varbind(PyObject* py_table_dict, column_t* column, PyObject* py_index_tuple, PyObject* py_varbind) {
-    PyObject* py_col_dict = NULL;
-    size_t out_len = 0;
+static int store_cell(table_info_t* table_info, column_t* column, netsnmp_variable_list *vars) {
+    row_t* row;
+    int col;
 
-    // do we start a new row?
-    py_col_dict = PyDict_GetItem(py_table_dict, py_index_tuple);    // PyDict_GetItem() only borrows us ref-to-col_dict
-    if (!py_col_dict) {
-        DBPRT(D_DBG, ("Creating new column dict\n"));
-        py_col_dict = PyDict_New();                                 // PyDict_New INCREF's py_col_dict
-        PyDict_SetItem(py_table_dict, py_index_tuple, py_col_dict); // PyDict_SetItem INCREF's py_index_tuple and py_col_dict
-        Py_XDECREF(py_col_dict);
+    if (!table_info->columnar) {
+        table_info->columnar = columnar_allocate(table_info->column_scheme.fields);
+        if (!table_info->columnar)
+            return FAILURE;
     }
 
-    PyDict_SetItem(py_col_dict, column->py_label_str, py_varbind);  // PyDict_SetItem INCREF's column->py_label_str and py_varbind
+    col = column - table_info->column_scheme.column;
+    row = find_row(table_info, column, vars);
+    if (!row || columnar_store(table_info->columnar, col, row->nr, vars) < 0)
+        return FAILURE;
+    if (table_info->layout == LAYOUT_CHANGES)
+        row->hash += changes_cell_hash(col, vars);
+    return SUCCESS;
+}
 
-    return out_len;
+/*
+ * Insert py_varbind into the row dictionary, keyed by column name.
+ *
+ * py_varbind is a borrowed reference.
+ */
+static int store_varbind(row_t* row, column_t* column, PyObject* py_varbind) {
+    return PyDict_SetItem(row->py_row_dict, column->py_label_str, py_varbind);  // PyDict_SetItem INCREF's column->py_label_str and py_varbind
 }
 
 int response_err(netsnmp_pdu *response) {
@@ -518,97 +1355,341 @@ int response_err(netsnmp_pdu *response) {
 }
 
 /*
+ * Format the value of a response varbind the way netsnmp.Varbind.val shows it. Doesn't need the GIL.
+ *
  * vars - variable binding from response
- * tp - pointer to object node in MIB
- * buf - parsed output from a netsnmp print_objid function
- * buf_len - size of buf
+ * column - column the varbind belongs to, carries the cached MIB node and type
+ * sprintval_flag - value formatting, see __snprint_value
+ * buf - receives the value, at least STR_BUF_SIZE bytes
+ * type - receives the translated type, see __translate_asn_type
+ *
+ * Returns the length of the formatted value.
  */
-PyObject* create_varbind(netsnmp_variable_list *vars, struct tree *tp, int sprintval_flag) {
-    int type;
-    int getlabel_flag = NO_FLAGS;
-    char type_str[MAX_TYPE_NAME_LEN];
-    u_char str_buf[STR_BUF_SIZE];
+static int format_value(netsnmp_variable_list *vars, column_t *column, int sprintval_flag,
+        char* buf, int* type) {
     int len;
+
+    if (column->is_leaf) {
+        /* type has been resolved from MIB once per column */
+        *type = column->type;
+    } else {
+        *type = __translate_asn_type(vars->type);
+    }
+
+    /* enums can only be looked up with a MIB node */
+    if (!column->tp && sprintval_flag == USE_ENUMS)
+        sprintval_flag = USE_BASIC;
+
+    len = __snprint_value(buf, STR_BUF_SIZE - 1, vars, column->tp, *type, sprintval_flag);
+    buf[len] = '\0';
+    DBPRT(D_DBG, ("Translated value %s\n", buf));
+    return len;
+}
+
+/*
+ * Create a netsnmp.Varbind from a value formatted by format_value.
+ *
+ * Return value: New reference.
+ */
+static PyObject* create_varbind(column_t *column, int type, char* val, int len) {
+    char type_str_buf[MAX_TYPE_NAME_LEN];
+    const char *type_str;
     PyObject *varbind = py_netsnmp_construct_varbind();
 
-//    if (py_netsnmp_attr_long(session, "UseEnums"))
-//      sprintval_flag = USE_ENUMS;
-//    if (py_netsnmp_attr_long(session, "UseSprintValue"))
-//      sprintval_flag = USE_SPRINT_VALUE;
+    if (!varbind)
+        return NULL;
 
-    if (__is_leaf(tp)) {
-        type = (tp->type ? tp->type : tp->parent->type);
-        getlabel_flag &= ~NON_LEAF_NAME;
-        DBPRT(D_DBG, ("netsnmp_get:is_leaf:%d\n",type));
+    if (column->is_leaf) {
+        type_str = column->type_str;
     } else {
-        getlabel_flag |= NON_LEAF_NAME;
-        type = __translate_asn_type(vars->type);
-        DBPRT(D_DBG, ("netsnmp_get:!is_leaf:%d\n",tp->type));
+        __get_type_str(type, type_str_buf);
+        type_str = type_str_buf;
     }
-
-    // __get_label_iid((char *) str_buf, &tag, &iid, getlabel_flag);
-    __get_type_str(type, type_str);
     DBPRT(D_DBG, ("Detected type id %i, type name = %s\n", type, type_str));
 
-    len = __snprint_value((char *) str_buf, sizeof(str_buf) - 1, vars, tp, type,
-            sprintval_flag);
-    str_buf[len] = '\0';
-    DBPRT(D_DBG, ("Translated value %s\n", str_buf));
-
-    py_netsnmp_attr_set_string(varbind, "type", type_str, strlen(type_str));
-    py_netsnmp_attr_set_string(varbind, "val", (char *) str_buf, len);
+    py_netsnmp_attr_set_string(varbind, "type", (char *) type_str, strlen(type_str));
+    py_netsnmp_attr_set_string(varbind, "val", val, len);
 
     return varbind;
 }
 
-PyObject* table_getbulk_sub_entries(table_info_t* table_info,
-        void* ss_opaque, int max_repeaters, PyObject *session) {
+/*
+ * Convert the value of a response varbind directly into a python object,
+ * without constructing a netsnmp.Varbind and without string formatting.
+ *
+ * INTEGER -> int, Counter32/Gauge32/TimeTicks/Unsigned32 -> int (or long),
+ * Counter64 -> long, OCTET STRING/Opaque/BITS/IpAddress -> str (raw octets),
+ * OBJECT IDENTIFIER -> tuple of ints, NULL and exception values -> None.
+ *
+ * Return value: New reference.
+ */
+PyObject* create_native_value(netsnmp_variable_list *vars) {
+    PyObject* py_value = NULL;
+    PyObject* py_subid = NULL;
+    struct counter64 *c64;
+    int nrof, i;
+
+    switch (vars->type) {
+    case ASN_INTEGER:
+        py_value = PyInt_FromLong(*vars->val.integer);
+        break;
+
+    case ASN_GAUGE:
+    case ASN_COUNTER:
+    case ASN_TIMETICKS:
+    case ASN_UINTEGER:
+        py_value = PyInt_FromSize_t((size_t) (u_long) *vars->val.integer);
+        break;
+
+    case ASN_COUNTER64:
+#ifdef OPAQUE_SPECIAL_TYPES
+    case ASN_OPAQUE_COUNTER64:
+    case ASN_OPAQUE_U64:
+#endif
+        c64 = vars->val.counter64;
+        py_value = PyLong_FromUnsignedLongLong(
+                ((unsigned PY_LONG_LONG) (c64->high & 0xffffffffUL) << 32)
+                        | (c64->low & 0xffffffffUL));
+        break;
+
+#ifdef OPAQUE_SPECIAL_TYPES
+    case ASN_OPAQUE_I64:
+        c64 = vars->val.counter64;
+        py_value = PyLong_FromLongLong((PY_LONG_LONG)
+                (((unsigned PY_LONG_LONG) (c64->high & 0xffffffffUL) << 32)
+                        | (c64->low & 0xffffffffUL)));
+        break;
+
+    case ASN_OPAQUE_FLOAT:
+        if (vars->val.floatVal)
+            py_value = PyFloat_FromDouble(*vars->val.floatVal);
+        break;
+
+    case ASN_OPAQUE_DOUBLE:
+        if (vars->val.doubleVal)
+            py_value = PyFloat_FromDouble(*vars->val.doubleVal);
+        break;
+#endif
+
+    case ASN_OCTET_STR:
+    case ASN_OPAQUE:
+    case ASN_BIT_STR:
+    case ASN_IPADDRESS:
+        py_value = PyString_FromStringAndSize((const char *) vars->val.string, vars->val_len);
+        break;
+
+    case ASN_OBJECT_ID:
+        nrof = vars->val_len / sizeof(oid);
+        py_value = PyTuple_New(nrof);
+        for (i = 0; py_value && i < nrof; i++) {
+            py_subid = PyInt_FromSize_t((size_t) vars->val.objid[i]);
+            if (!py_subid) {
+                Py_CLEAR(py_value);
+                break;
+            }
+            PyTuple_SET_ITEM(py_value, i, py_subid);  // steals reference to py_subid
+        }
+        break;
+
+    case ASN_NULL:
+    case SNMP_ENDOFMIBVIEW:
+    case SNMP_NOSUCHOBJECT:
+    case SNMP_NOSUCHINSTANCE:
+    default:
+        break;
+    }
+
+    if (!py_value && !PyErr_Occurred()) {
+        Py_INCREF(Py_None);
+        py_value = Py_None;
+    }
+    return py_value;
+}
+
+/*
+ * Compare a counter cell with its value from the previous rate poll, and remember the new value.
+ * Counter32 values that went down have wrapped around once. Counter64 values don't wrap in practice,
+ * so going down is taken as discontinuity. Cells of other types get their native value.
+ *
+ * Return value: New reference to a tuple (delta, rate per second), or to None if there is no
+ * previous value. NULL with exception set on error.
+ */
+static PyObject* create_rate(table_info_t* table_info, netsnmp_variable_list *vars, double now) {
+    oid_map_entry_t* entry;
+    rate_state_t* state;
+    unsigned PY_LONG_LONG value, delta = 0;
+    double elapsed;
+    int created;
+    int valid;
+
+    switch (vars->type) {
+    case ASN_COUNTER:
+        value = (u_long) *vars->val.integer & 0xffffffffUL;
+        break;
+    case ASN_COUNTER64:
+        value = ((unsigned PY_LONG_LONG) (vars->val.counter64->high & 0xffffffffUL) << 32)
+                | (vars->val.counter64->low & 0xffffffffUL);
+        break;
+    default:
+        return create_native_value(vars);
+    }
+
+    entry = oid_map_insert(&table_info->rate_state, vars->name, vars->name_length, &created);
+    if (!entry)
+        return PyErr_NoMemory();
+    state = (rate_state_t*) entry->data;
+
+    elapsed = now - state->time;
+    valid = !created && elapsed > 0;
+    if (vars->type == ASN_COUNTER)
+        delta = (value - state->value) & 0xffffffffUL;
+    else if (value >= state->value)
+        delta = value - state->value;
+    else
+        valid = 0;
+
+    state->value = value;
+    state->time = now;
+    state->generation = table_info->rate_generation;
+    if (!valid)
+        return Py_BuildValue("");
+    return Py_BuildValue("(Kd)", delta, (double) delta / elapsed);
+}
+
+/* Start a rate poll. Cells not seen since the previous one are dropped by table_rates_prune. */
+void table_rates_begin(table_info_t* table_info) {
+    table_info->rate_generation++;
+}
+
+static int rate_seen(oid_map_entry_t* entry, void* ctx) {
+    return ((rate_state_t*) entry->data)->generation == *(unsigned long*) ctx;
+}
+
+/*
+ * Forget counters of rows that have gone, after a complete rate poll.
+ * Returns -1 if out of memory.
+ */
+int table_rates_prune(table_info_t* table_info) {
+    return oid_map_retain(&table_info->rate_state, rate_seen, &table_info->rate_generation, NULL);
+}
+
+/* Forget all previous counter values, e.g. after the agent restarted. */
+void table_rates_reset(table_info_t* table_info) {
+    oid_map_clear(&table_info->rate_state, NULL);
+}
+
+/*
+ * Statistics of the most recent fetch as dictionary, None if they were not collected.
+ * See fetch_stats_t for the meaning of the keys. rtt_histogram is a list of (upper bound in ms, count),
+ * the last upper bound is None.
+ *
+ * Return value: New reference.
+ */
+PyObject* table_get_stats(table_info_t* table_info) {
+    fetch_stats_t* stats = &table_info->stats;
+    PyObject* py_hist;
+    PyObject* py_bucket;
+    PyObject* py_repetitions;
+    PyObject* py_value;
+    int i;
+
+    if (!table_info->collect_stats)
+        return Py_BuildValue("");
+
+    py_repetitions = PyList_New(stats->nr_of_repetitions);
+    if (!py_repetitions)
+        return NULL;
+    for (i = 0; i < (int) stats->nr_of_repetitions; i++) {
+        py_value = PyInt_FromLong(stats->max_repetitions[i]);
+        if (!py_value) {
+            Py_DECREF(py_repetitions);
+            return NULL;
+        }
+        PyList_SET_ITEM(py_repetitions, i, py_value);  // steals reference to py_value
+    }
+
+    py_hist = PyList_New(STATS_RTT_BUCKETS);
+    if (!py_hist) {
+        Py_DECREF(py_repetitions);
+        return NULL;
+    }
+    for (i = 0; i < STATS_RTT_BUCKETS; i++) {
+        if (i < STATS_RTT_BUCKETS - 1)
+            py_bucket = Py_BuildValue("(ik)", 1 << i, stats->rtt_hist[i]);
+        else
+            py_bucket = Py_BuildValue("(Ok)", Py_None, stats->rtt_hist[i]);
+        if (!py_bucket) {
+            Py_DECREF(py_hist);
+            Py_DECREF(py_repetitions);
+            return NULL;
+        }
+        PyList_SET_ITEM(py_hist, i, py_bucket);  // steals reference to py_bucket
+    }
+
+    return Py_BuildValue("{s:k,s:k,s:k,s:N,s:k,s:k,s:k,s:k,s:k,s:k,s:N,s:d,s:d,s:d}",
+            "pdus_sent", stats->pdus_sent,
+            "request_bytes", stats->request_bytes,
+            "response_bytes", stats->response_bytes,
+            "rtt_histogram", py_hist,
+            "varbinds_received", stats->varbinds_received,
+            "varbinds_discarded", stats->varbinds_discarded,
+            "retries", stats->retries,
+            "too_big", stats->too_big,
+            "index_tuples", stats->index_tuples,
+            "cells_stored", stats->cells_stored,
+            "max_repetitions", py_repetitions,
+            "network_seconds", stats->network_seconds,
+            "decode_seconds", stats->decode_seconds,
+            "materialize_seconds", stats->materialize_seconds);
+}
+
+/*
+ * Prepare the per-column request state for a new walk.
+ * Each column starts at the table root, plus the start index if one was given,
+ * or where a previous walk stopped if a cursor has been set with table_set_cursor.
+ * max_repeaters is the max-repetitions of the first request. In adaptive mode it is only a first guess.
+ */
+void table_walk_init(table_info_t* table_info, int max_repeaters) {
     column_scheme_t* column_scheme = &table_info->column_scheme;
-    int running = 1;
-    netsnmp_pdu *pdu, *response;
-    netsnmp_variable_list *vars;
-    struct tree *tp;
-    int buf_over = 0;
-    int status;
-    int col;
-    u_char *buf = NULL;
-    size_t buf_len = 0;
-    size_t out_len;
-    int exitval = SUCCESS;
     column_t* column;
-    int tmp_dont_breakdown_oids;
-    PyObject* py_table_dict = NULL;
-    PyObject* py_index_tuple = NULL;
-    PyObject* py_varbind = NULL;
-    int nr_of_requested_columns = 0;
     int nr_of_subindex = 0;
-    int response_vb_count = 0;
-    int nr_columns_ended = 0;
-    int retry_nosuch = 0;
-    char err_str[STR_BUF_SIZE];
-    int err_num;
-    int err_ind;
-
-    /* Create function, transfers reference ownership. */
-    py_table_dict = PyDict_New();
+    int col;
 
-    /* Get table string index as string, not as dotted numbers. 1 = dont print oid indexes specially, 0 = print oid indexes specially. */
-    tmp_dont_breakdown_oids = netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
-            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS);
-    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
-            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS, 0);
+    oid_map_clear(&table_info->row_cache, row_release);
+    columnar_deallocate(table_info->columnar);
+    table_info->columnar = NULL;
+    table_info->nr_of_requested_columns = 0;
+
+    table_info->repeaters.current = max_repeaters;
+    if (table_info->repeaters.adaptive && table_info->repeaters.current < 1)
+        table_info->repeaters.current = 1;
+    table_info->repeaters.requested = 0;
+    table_info->repeaters.vb_ceiling = 0;
+    memset(&table_info->stats, 0, sizeof(fetch_stats_t));
+    table_info->scalars_pending = table_info->nr_of_scalars > 0;
+    table_info->scalars_requested = 0;
+    Py_CLEAR(table_info->py_scalar_values);
 
     nr_of_subindex = get_nr_of_subidx(table_info->column_scheme.start_idx, table_info->column_scheme.start_idx_length,
                                        table_info->index_vars, table_info->index_vars_nrof);
+    column_scheme->end_idx_complete = column_scheme->end_idx_length > 0
+            && get_nr_of_subidx(column_scheme->end_idx, column_scheme->end_idx_length,
+                    table_info->index_vars, table_info->index_vars_nrof) == table_info->index_vars_nrof;
 
     /* initial setup for 1st getbulk request */
     for (col = 0; col < column_scheme->fields; col++) {
         column = &column_scheme->column[col];
-        column->last_oid_len = column_scheme->name_length;
-        column->end = 0;
-        memcpy(column->last_oid, column_scheme->name,
-                column_scheme->name_length * sizeof(oid));
-        column->last_oid[column->last_oid_len++] = column->subid;
+        column->last_var = NULL;
+        if (table_info->resume) {
+            /* position has been restored from the cursor */
+            column->end = column->end || !column->selected;
+            DBPRTOID(D_DBG, "column resumes after", column->last_oid, column->last_oid_len);
+            continue;
+        }
+        /* columns which are not selected are never requested */
+        column->end = !column->selected;
+        memcpy(column->last_oid, column->name, column->name_length * sizeof(oid));
+        column->last_oid_len = column->name_length;
 
         /* append the start index, if any */
         if (table_info->column_scheme.start_idx_length > 0) {
@@ -630,157 +1711,862 @@ PyObject* table_getbulk_sub_entries(table_info_t* table_info,
 
         DBPRTOID(D_DBG, "column last varbind OID", column->last_oid, column->last_oid_len);
     }
+    table_info->resume = 0;
+}
 
-    DBPRT(D_DBG, ("max_repeaters = %i\n", max_repeaters));
-    while (running) {
-        nr_of_requested_columns = 0;
+/*
+ * Number of instances a column can have at most until end_idx, for trimming max-repetitions.
+ * Known if the last received instance and end_idx only differ in their last sub-identifier,
+ * e.g. for integer indexes. Returns -1 if unknown.
+ */
+static long remaining_until_end_idx(column_scheme_t* column_scheme, column_t* column) {
+    size_t suffix_start = column->name_length;
+    size_t suffix_len;
+    oid* suffix;
+
+    if (column_scheme->end_idx_length == 0 || column->last_oid_len <= suffix_start)
+        return -1;
+
+    suffix = &column->last_oid[suffix_start];
+    suffix_len = column->last_oid_len - suffix_start;
+    if (suffix_len != column_scheme->end_idx_length
+            || memcmp(suffix, column_scheme->end_idx, (suffix_len - 1) * sizeof(oid))
+            || suffix[suffix_len - 1] > column_scheme->end_idx[suffix_len - 1])
+        return -1;
+    return (long) (column_scheme->end_idx[suffix_len - 1] - suffix[suffix_len - 1]);
+}
 
-        /*
-         * create PDU for GETBULK request and add object name to request
-         */
+/*
+ * Create the next GETBULK request of a walk, or GETNEXT request if use_getnext is set.
+ * All columns which have not ended yet are requested, starting after their last received instance.
+ * A GETNEXT request carries one varbind per column, and its response is parsed like a GETBULK
+ * response with max-repetitions 1.
+ * Only these columns are put into position_map, so response varbinds can be mapped back to them.
+ * Max-repetitions is applied per column, so the varbind budget of a request shrinks as columns end.
+ * With an end index, columns which have reached it are ended here, and max-repetitions is trimmed
+ * to the instances left in the range, if that number is known.
+ *
+ * Return value: New PDU, owned by the caller. NULL if there is no column left to request.
+ */
+netsnmp_pdu* table_walk_request(table_info_t* table_info) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    column_t* column;
+    netsnmp_pdu *pdu;
+    int repeaters = table_info->repeaters.current;
+    long remaining, max_remaining = 0;
+    int col;
+
+    table_info->nr_of_requested_columns = 0;
+    for (col = 0; col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        if (column->end || column_scheme->end_idx_length == 0)
+            continue;
+        remaining = remaining_until_end_idx(column_scheme, column);
+        if (remaining == 0 && column_scheme->end_idx_complete) {
+            DBPRT(D_DBG, ("Column %lu reached the end index\n", (unsigned long) column->subid));
+            column->end = 1;
+        } else if (remaining < 0 || max_remaining < 0) {
+            max_remaining = -1;
+        } else if (remaining > max_remaining) {
+            max_remaining = remaining;
+        } else if (max_remaining == 0) {
+            max_remaining = 1; // instances below a prefix end index may still follow
+        }
+    }
+    if (max_remaining > 0 && max_remaining < repeaters)
+        repeaters = (int) max_remaining;
+
+    for (col = 0; col < column_scheme->fields; col++) {
+        if (!column_scheme->column[col].end)
+            break;
+    }
+    if (col == column_scheme->fields)
+        return NULL;
+
+    /*
+     * create PDU for GETBULK request and add object name to request
+     */
+    if (table_info->use_getnext) {
+        pdu = snmp_pdu_create(SNMP_MSG_GETNEXT);
+        table_info->repeaters.requested = 1;
+    } else {
         pdu = snmp_pdu_create(SNMP_MSG_GETBULK);
         pdu->non_repeaters = 0;
-        pdu->max_repetitions = max_repeaters;
+        pdu->max_repetitions = repeaters;
+        table_info->repeaters.requested = repeaters;
+        DBPRT(D_DBG, ("max_repeaters = %i\n", repeaters));
+    }
+    if (table_info->collect_stats && table_info->stats.nr_of_repetitions < STATS_REPETITIONS)
+        table_info->stats.max_repetitions[table_info->stats.nr_of_repetitions++] = table_info->repeaters.requested;
+
+    /* scalars go first, until a response has answered them */
+    table_info->scalars_requested = 0;
+    if (table_info->scalars_pending) {
+        for (col = 0; col < table_info->nr_of_scalars; col++) {
+            snmp_add_null_var(pdu, table_info->scalars[col].request, table_info->scalars[col].request_len);
+        }
+        table_info->scalars_requested = table_info->nr_of_scalars;
+        if (!table_info->use_getnext)
+            pdu->non_repeaters = table_info->nr_of_scalars;
+    }
 
-        for (col = 0; col < column_scheme->fields; col++) {
-            column = &column_scheme->column[col];
+    for (col = 0; col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
 
-            /* column_varbinds is updated during each resonse parsing */
-            if (!column->end) {
-                DBPRTOID(D_DBG, "add oid to getbulk request pdu", column->last_oid, column->last_oid_len);
-                snmp_add_null_var(pdu, column->last_oid, column->last_oid_len);
-                table_info->column_scheme.position_map[nr_of_requested_columns++] =
-                        column;
-            }
-            column->last_var = NULL;
-            column->end = 0;
+        /* column_varbinds is updated during each resonse parsing */
+        if (!column->end) {
+            DBPRTOID(D_DBG, "add oid to getbulk request pdu", column->last_oid, column->last_oid_len);
+            snmp_add_null_var(pdu, column->last_oid, column->last_oid_len);
+            table_info->column_scheme.position_map[table_info->nr_of_requested_columns++] =
+                    column;
         }
+        column->last_var = NULL;
+    }
 
-        /*
-         * do the request
-         */
-        DBPRT(D_DBG, ("do getbulk request\n"));
+    return pdu;
+}
 
-#ifdef NETSNMP_SINGLE_API
-        DBPRT(D_DBG, ("session (single API) - version code %lu, community %s\n", snmp_sess_session((void*)ss_opaque)->version, snmp_sess_session((void*)ss_opaque)->community));
-#else
-        DBPRT(D_DBG, ("session (traditional API) - version code %lu, community %s\n", ((netsnmp_session*)ss_opaque)->version, ((netsnmp_session*)ss_opaque)->community));
-#endif
+/*
+ * Adjust max-repetitions to the response of the most recent request, in adaptive mode.
+ *
+ * A response with all requested varbinds doubles max-repetitions for the next request.
+ * A shorter response means the agent truncated it to fit its message size, so the next requests
+ * stay below what the agent delivered. Responses in which columns ended are short for another reason,
+ * and leave max-repetitions as is.
+ */
+static void adapt_repeaters(table_info_t* table_info, int nr_of_varbinds, int nr_columns_ended) {
+    repeaters_t* repeaters = &table_info->repeaters;
+    int nr_of_columns = table_info->nr_of_requested_columns;
+    int next;
 
-        retry_nosuch = 0; // = py_netsnmp_attr_long(session, "RetryNoSuch");
-        status = __send_sync_pdu(ss_opaque, pdu, &response, retry_nosuch, err_str,
-                &err_num, &err_ind);
-        __py_netsnmp_update_session_errors(session, err_str, err_num, err_ind);
+    if (!repeaters->adaptive || table_info->use_getnext || nr_columns_ended || nr_of_columns == 0)
+        return;
 
-        /* Allocates response->vars list. snmp_free_pdu destroys it at the end of the loop. */
-        if (status == STAT_SUCCESS) {
-            DBPRT(D_DBG, ("got success response\n"));
-            if (response->errstat == SNMP_ERR_NOERROR) {
-                /*
-                 * check resulting variables
-                 */
-                vars = response->variables;
-                response_vb_count = 0;
-                nr_columns_ended = 0;
-                DBPRT(D_DBG, ("parse response\n"));
-                while (vars && exitval != FAILURE) {
-                    /* Get the string representation from returned identifier.
-                     * Depending on session settings, this may be dotted notation,
-                     * or as MIB name.
-                     */
-                    out_len = 0;
-                    DBPRTOID(D_DBG, "Response OID: ", vars->name, vars->name_length);
-                    tp = netsnmp_sprint_realloc_objid_tree(&buf, &buf_len,
-                            &out_len, 1, &buf_over, vars->name,
-                            vars->name_length);
-
-                    DBPRT(D_DBG, ("print-name of varbind = %s, len = %lu, tp = %p\n", buf, buf_len, tp));
-
-                    int response_slot = response_vb_count
-                            % nr_of_requested_columns;
-                    column = get_column_validated(table_info, vars,
-                            response_slot);
-
-                    if (!column) {
-                        /* skip this variable */
-                        if (!column_scheme->column[response_slot].end) {
-                            DBPRT(D_DBG, ("Detected end of column %i\n", response_slot));
-                            column_scheme->column[response_slot].end = 1;
-                            nr_columns_ended++;
-                            if (nr_columns_ended == nr_of_requested_columns) {
-                                DBPRT(D_DBG, ("Detected end of all columns\n"));
-                                running = 0;
-                                break;
-                            }
-                        }
-                        vars = vars->next_variable;
-                        response_vb_count++;
-                        continue;
-                    }
+    if (nr_of_varbinds < repeaters->requested * nr_of_columns) {
+        repeaters->vb_ceiling = nr_of_varbinds + 1;
+        next = nr_of_varbinds / nr_of_columns;
+    } else {
+        next = repeaters->current * 2;
+        if (next > ADAPTIVE_MAX_REPEATERS)
+            next = ADAPTIVE_MAX_REPEATERS;
+        if (repeaters->vb_ceiling && next * nr_of_columns >= repeaters->vb_ceiling)
+            next = (repeaters->vb_ceiling - 1) / nr_of_columns;
+        if (next < repeaters->current)
+            next = repeaters->current;
+    }
+    repeaters->current = next > 0 ? next : 1;
+    DBPRT(D_DBG, ("adaptive max_repeaters: %i varbinds received, next request %i\n",
+            nr_of_varbinds, repeaters->current));
+}
 
-                    DBPRT(D_DBG, ("Update latest varbind pointer\n"));
-                    column->last_var = vars;
+/*
+ * The agent answered the most recent request with tooBig.
+ * In adaptive mode, max-repetitions is halved and 1 is returned, the caller sends the next request again.
+ * Returns 0 if the request can't get any smaller, which ends the walk with the error.
+ */
+int table_walk_too_big(table_info_t* table_info) {
+    repeaters_t* repeaters = &table_info->repeaters;
 
-                    /* name_p now points to instance id part of OID */
-                    py_index_tuple = create_index_tuple(&vars->name[table_info->rootlen+1], vars->name_length-table_info->rootlen-1, table_info->index_vars, table_info->index_vars_nrof);
-                    py_varbind = create_varbind(vars, tp, table_info->sprintval_flag);
-                    if (py_index_tuple && py_varbind) {
-                    	store_varbind(py_table_dict, column, py_index_tuple, py_varbind);
-                    } else {
-                        running = 0;
-                        exitval = FAILURE;
-                    }
-                    Py_XDECREF(py_index_tuple);
-                    Py_XDECREF(py_varbind);
+    table_info->stats.too_big++;
+    if (!repeaters->adaptive || repeaters->requested <= 1)
+        return 0;
 
-                    vars = vars->next_variable;
-                    response_vb_count++;
-                }
+    repeaters->vb_ceiling = repeaters->requested * table_info->nr_of_requested_columns;
+    repeaters->current = repeaters->requested / 2;
+    DBPRT(D_DBG, ("response too big, retry with max_repeaters = %i\n", repeaters->current));
+    return 1;
+}
 
-                /* All varbinds in response have been processed. Check which varbinds have to be added to the next getbulk request. */
-                for (col = 0; col < column_scheme->fields; col++) {
-                    column = &column_scheme->column[col];
-                    /* response vars list will be freed soon, save initial oids for next request */
-                    if (!column->end && column->last_var) {
-                        column->last_oid_len = column->last_var->name_length;
-                        memcpy(column->last_oid, column->last_var->name,
-                                column->last_var->name_length * sizeof(oid));
-                    }
-                }
-            } else {
-                if (response->errstat == SNMP_ERR_NOSUCHNAME) {
-                    /* If we receive SNMP_ERR_NOSUCHNAME error status for a getbulk request,
-                       we probably have a buggy agent that tells us "end of mib" the old SNMPv1 way.
-                       Because end of MIB is OK, clear errors. */
-                    err_str[0] = '\0';
+/*
+ * The agent answered the most recent request with noSuchName.
+ * An SNMPv1 agent does so for GETNEXT when a column has no successor in its MIB view, errindex tells
+ * which one. That column ends, and 1 is returned if others remain, the caller sends the next request then.
+ * For GETBULK it's a buggy agent that tells "end of mib" the old way, all columns end.
+ * Returns 0 if the walk is complete.
+ */
+int table_walk_no_such_name(table_info_t* table_info, netsnmp_pdu* response) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    int col;
+
+    if (table_info->use_getnext && response->errindex >= 1
+            && response->errindex <= table_info->scalars_requested) {
+        /* nothing follows a scalar, give up the scalars and repeat the request */
+        table_info->scalars_pending = 0;
+        return 1;
+    }
+    if (table_info->use_getnext && response->errindex > table_info->scalars_requested
+            && response->errindex <= table_info->scalars_requested + table_info->nr_of_requested_columns) {
+        column_scheme->position_map[response->errindex - table_info->scalars_requested - 1]->end = 1;
+        for (col = 0; col < column_scheme->fields; col++) {
+            if (!column_scheme->column[col].end)
+                return 1;
+        }
+        return 0;
+    }
+
+    /* nothing left to resume */
+    for (col = 0; col < column_scheme->fields; col++)
+        column_scheme->column[col].end = 1;
+    return 0;
+}
+
+/* Make room for nr_of_cells more decoded cells, and one more formatted value. */
+static int decode_buf_reserve(decode_buf_t* buf, size_t nr_of_cells) {
+    decoded_cell_t* cell;
+    char* text;
+    size_t size;
+
+    if (buf->nr_of_cells + nr_of_cells > buf->size) {
+        size = buf->nr_of_cells + nr_of_cells;
+        cell = realloc(buf->cell, size * sizeof(decoded_cell_t));
+        if (!cell)
+            return FAILURE;
+        buf->cell = cell;
+        buf->size = size;
+    }
+    if (buf->text_len + STR_BUF_SIZE > buf->text_size) {
+        size = buf->text_size ? buf->text_size * 2 : 16 * STR_BUF_SIZE;
+        while (buf->text_len + STR_BUF_SIZE > size)
+            size *= 2;
+        text = realloc(buf->text, size);
+        if (!text)
+            return FAILURE;
+        buf->text = text;
+        buf->text_size = size;
+    }
+    return SUCCESS;
+}
+
+/*
+ * Whether every filter column has delivered its cell of a row, or has passed or ended without one.
+ * Columns are walked in instance order, so the row gets no more filter cells then.
+ */
+static int filter_columns_passed(table_info_t* table_info, row_t* row, oid* suffix, size_t suffix_len) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    column_t* column;
+    int col, bit;
+
+    for (col = 0; col < column_scheme->fields; col++) {
+        bit = table_info->filter->column_bit[col];
+        column = &column_scheme->column[col];
+        if (bit < 0 || ((row->filter_seen >> bit) & 1) || column->end)
+            continue;
+        if (column->last_oid_len <= column->name_length
+                || snmp_oid_compare(&column->last_oid[column->name_length],
+                        column->last_oid_len - column->name_length, suffix, suffix_len) < 0)
+            return 0;
+    }
+    return 1;
+}
+
+/*
+ * First phase of response parsing, runs without holding the GIL.
+ *
+ * Validates all varbinds of an error free response to the request from table_walk_request,
+ * advances the per-column request state, and finds the row of each cell in the row cache.
+ * In varbind mode, values are formatted into the decode buffer. The columnar layout stores its
+ * cells completely here. A row filter evaluates its atoms on the cells, and decides the rows it can.
+ * No python object is touched; table_walk_materialize does that afterwards.
+ *
+ * Returns WALK_CONTINUE if another request is needed, WALK_DONE at the end of the table,
+ * WALK_FAILURE if out of memory.
+ */
+int table_walk_decode(table_info_t* table_info, netsnmp_pdu* response) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    decode_buf_t* buf = &table_info->decode_buf;
+    decoded_cell_t* cell;
+    netsnmp_variable_list *vars;
+    column_t* column;
+    row_t* row;
+    int nr_of_requested_columns = table_info->nr_of_requested_columns;
+    int response_vb_count = 0;
+    int nr_columns_ended = 0;
+    int ret = WALK_CONTINUE;
+    int col;
+    size_t i;
+    double start = table_info->collect_stats ? __now_seconds() : 0;
+
+    buf->nr_of_cells = 0;
+    buf->text_len = 0;
+    for (vars = response->variables; vars; vars = vars->next_variable)
+        response_vb_count++;
+    if (decode_buf_reserve(buf, response_vb_count) < 0)
+        return WALK_FAILURE;
+    response_vb_count = 0;
+
+    /*
+     * check resulting variables
+     */
+    vars = response->variables;
+    DBPRT(D_DBG, ("parse response\n"));
+    buf->scalar_vars = NULL;
+    buf->nr_of_scalar_vars = 0;
+    if (table_info->scalars_requested) {
+        /* non-repeaters come first, table_walk_materialize takes them */
+        buf->scalar_vars = vars;
+        while (vars && buf->nr_of_scalar_vars < table_info->scalars_requested) {
+            buf->nr_of_scalar_vars++;
+            vars = vars->next_variable;
+        }
+        table_info->scalars_pending = 0;
+    }
+    while (vars && ret != WALK_FAILURE) {
+        DBPRTOID(D_DBG, "Response OID: ", vars->name, vars->name_length);
+
+        int response_slot = response_vb_count
+                % nr_of_requested_columns;
+        column = get_column_validated(table_info, vars,
+                response_slot);
+
+        if (!column || column->end) {
+            /* skip this variable, its column has ended */
+            if (table_info->collect_stats)
+                table_info->stats.varbinds_discarded++;
+            column = table_info->column_scheme.position_map[response_slot];
+            if (!column->end) {
+                DBPRT(D_DBG, ("Detected end of column %i\n", response_slot));
+                column->end = 1;
+                nr_columns_ended++;
+                if (nr_columns_ended == nr_of_requested_columns) {
+                    DBPRT(D_DBG, ("Detected end of all columns\n"));
+                    ret = WALK_DONE;
+                    break;
+                }
+            }
+            vars = vars->next_variable;
+            response_vb_count++;
+            continue;
+        }
+
+        DBPRT(D_DBG, ("Update latest varbind pointer\n"));
+        column->last_var = vars;
+
+        if (table_info->layout != LAYOUT_ROWS) {
+            if (store_cell(table_info, column, vars) < 0)
+                ret = WALK_FAILURE;
+        } else if ((row = find_row(table_info, column, vars))) {
+            /* parse the index here, materialize_row only turns it into python objects */
+            if (!row->index && decode_index(&vars->name[column->name_length],
+                    vars->name_length - column->name_length,
+                    table_info->index_vars, table_info->index_vars_nrof, &row->index) < 0)
+                ret = WALK_FAILURE;
+            if (table_info->filter)
+                filter_cell(table_info->filter, row, column - column_scheme->column, vars);
+            cell = &buf->cell[buf->nr_of_cells++];
+            cell->column = column;
+            cell->row = row;
+            cell->vars = vars;
+            cell->text_start = buf->text_len;
+            cell->text_len = 0;
+            if (table_info->value_mode == VALUE_MODE_VARBIND && !column->filter_only) {
+                if (decode_buf_reserve(buf, 0) < 0) {
+                    ret = WALK_FAILURE;
+                } else {
+                    cell->text_len = format_value(vars, column, table_info->sprintval_flag,
+                            buf->text + cell->text_start, &cell->type);
+                    buf->text_len += cell->text_len + 1;
+                }
+            }
+        } else {
+            ret = WALK_FAILURE;
+        }
+
+        vars = vars->next_variable;
+        response_vb_count++;
+    }
+
+    /* All varbinds in response have been processed. Check which varbinds have to be added to the next getbulk request. */
+    for (col = 0; col < column_scheme->fields; col++) {
+        column = &column_scheme->column[col];
+        /* response vars list will be freed soon, save initial oids for next request */
+        if (!column->end && column->last_var) {
+            column->last_oid_len = column->last_var->name_length;
+            memcpy(column->last_oid, column->last_var->name,
+                    column->last_var->name_length * sizeof(oid));
+        }
+        column->last_var = NULL;
+    }
+
+    /* decide the rows that have got all they will get from the filter columns, before materializing */
+    for (i = 0; table_info->filter && i < buf->nr_of_cells; i++) {
+        cell = &buf->cell[i];
+        if (cell->row->filter_verdict == FILTER_UNKNOWN && filter_columns_passed(table_info, cell->row,
+                &cell->vars->name[cell->column->name_length],
+                cell->vars->name_length - cell->column->name_length))
+            cell->row->filter_verdict = filter_row(table_info->filter, cell->row);
+    }
+
+    if (ret == WALK_CONTINUE)
+        adapt_repeaters(table_info, response_vb_count, nr_columns_ended);
+
+    if (table_info->collect_stats) {
+        table_info->stats.varbinds_received += response_vb_count;
+        table_info->stats.decode_seconds += __now_seconds() - start;
+    }
+    return ret;
+}
+
+/*
+ * In a rate poll, an agent uptime that went down means the agent restarted, and all counters did.
+ * Previous values are dropped then, before the cells of the poll are compared with them.
+ */
+static void check_rate_uptime(table_info_t* table_info, netsnmp_variable_list* vars) {
+    unsigned long uptime = (u_long) *vars->val.integer;
+
+    if (table_info->rate_uptime_known && uptime < table_info->rate_uptime) {
+        DBPRT(D_DBG, ("Agent uptime went down, dropping previous counter values\n"));
+        table_rates_reset(table_info);
+    }
+    table_info->rate_uptime = uptime;
+    table_info->rate_uptime_known = 1;
+}
+
+/*
+ * Create the values of the scalars from the response that answered them.
+ * A varbind that is not the scalar itself, but its successor in the agent's MIB view, means the agent
+ * doesn't have the scalar. Returns -1 with exception set on error.
+ */
+static int materialize_scalars(table_info_t* table_info) {
+    decode_buf_t* buf = &table_info->decode_buf;
+    netsnmp_variable_list* vars = buf->scalar_vars;
+    scalar_t* scalar;
+    column_t column;
+    char text[STR_BUF_SIZE];
+    PyObject* py_values;
+    PyObject* py_value;
+    int type, len, i;
+
+    py_values = PyTuple_New(table_info->nr_of_scalars);
+    if (!py_values)
+        return FAILURE;
+    memset(&column, 0, sizeof(column));
+    for (i = 0; i < table_info->nr_of_scalars; i++) {
+        scalar = &table_info->scalars[i];
+        if (i >= buf->nr_of_scalar_vars || !vars
+                || snmp_oid_compare(vars->name, vars->name_length, scalar->name, scalar->name_len) != 0
+                || vars->type == SNMP_NOSUCHOBJECT || vars->type == SNMP_NOSUCHINSTANCE
+                || vars->type == SNMP_ENDOFMIBVIEW) {
+            Py_INCREF(Py_None);
+            py_value = Py_None;
+        } else if (table_info->value_mode == VALUE_MODE_VARBIND) {
+            len = format_value(vars, &column, table_info->sprintval_flag, text, &type);
+            py_value = create_varbind(&column, type, text, len);
+        } else if (table_info->value_mode == VALUE_MODE_RATE && i == 0 && vars->type == ASN_TIMETICKS) {
+            check_rate_uptime(table_info, vars);
+            py_value = create_native_value(vars);
+        } else {
+            py_value = create_native_value(vars);
+        }
+        if (!py_value) {
+            Py_DECREF(py_values);
+            return FAILURE;
+        }
+        PyTuple_SET_ITEM(py_values, i, py_value);  // steals reference to py_value
+        if (vars)
+            vars = vars->next_variable;
+    }
+    Py_XDECREF(table_info->py_scalar_values);
+    table_info->py_scalar_values = py_values;
+    return SUCCESS;
+}
+
+/*
+ * Second phase of response parsing, with the GIL held.
+ * Creates the python objects for all cells that table_walk_decode found, and stores them into
+ * their rows. The decoded response must not be freed before.
+ *
+ * Returns -1 on error, with exception set if python raised one.
+ */
+int table_walk_materialize(table_info_t* table_info, PyObject* py_table_dict) {
+    decode_buf_t* buf = &table_info->decode_buf;
+    decoded_cell_t* cell;
+    PyObject* py_varbind = NULL;
+    size_t i;
+    int ret = SUCCESS;
+    double start = table_info->collect_stats ? __now_seconds() : 0;
+    double now = table_info->value_mode == VALUE_MODE_RATE ? __now_seconds() : 0;
+
+    if (buf->scalar_vars && materialize_scalars(table_info) < 0)
+        ret = FAILURE;
+    buf->scalar_vars = NULL;
+    buf->nr_of_scalar_vars = 0;
+
+    for (i = 0; i < buf->nr_of_cells && ret == SUCCESS; i++) {
+        cell = &buf->cell[i];
+        if (cell->row->filter_verdict == FILTER_REJECT || cell->column->filter_only)
+            continue;
+        if (materialize_row(table_info, cell->row, cell->column, cell->vars, py_table_dict) < 0) {
+            ret = FAILURE;
+            break;
+        }
+        if (table_info->value_mode == VALUE_MODE_NATIVE)
+            py_varbind = create_native_value(cell->vars);
+        else if (table_info->value_mode == VALUE_MODE_RATE)
+            py_varbind = create_rate(table_info, cell->vars, now);
+        else
+            py_varbind = create_varbind(cell->column, cell->type,
+                    buf->text + cell->text_start, cell->text_len);
+        if (!py_varbind || store_varbind(cell->row, cell->column, py_varbind) < 0)
+            ret = FAILURE;
+        else if (table_info->collect_stats)
+            table_info->stats.cells_stored++;
+        Py_XDECREF(py_varbind);
+    }
+    buf->nr_of_cells = 0;
+    buf->text_len = 0;
+    if (table_info->collect_stats)
+        table_info->stats.materialize_seconds += __now_seconds() - start;
+    return ret;
+}
+
+/*
+ * Store all varbinds of an error free response to the request from table_walk_request into py_table_dict,
+ * and advance the per-column request state. Both parsing phases in one go, with the GIL held.
+ *
+ * Returns WALK_CONTINUE if another request is needed, WALK_DONE at the end of the table, WALK_FAILURE on error.
+ */
+int table_walk_response(table_info_t* table_info, netsnmp_pdu* response, PyObject* py_table_dict) {
+    int ret = table_walk_decode(table_info, response);
+
+    if (ret == WALK_FAILURE) {
+        PyErr_NoMemory();
+        return WALK_FAILURE;
+    }
+    if (table_walk_materialize(table_info, py_table_dict) < 0)
+        return WALK_FAILURE;
+    return ret;
+}
+
+/*
+ * At the end of a walk, decide the rows the filter hasn't decided yet with the cells they got,
+ * and remove the rejected rows that already made it into py_table_dict.
+ * Returns -1 with exception set on error.
+ */
+int table_walk_filter_rows(table_info_t* table_info, PyObject* py_table_dict) {
+    oid_map_t* row_cache = &table_info->row_cache;
+    row_t* row;
+    size_t i;
+
+    for (i = 0; i < row_cache->size; i++) {
+        if (!row_cache->slots[i].key)
+            continue;
+        row = (row_t*) row_cache->slots[i].data;
+        if (row->filter_verdict == FILTER_UNKNOWN)
+            row->filter_verdict = filter_row(table_info->filter, row);
+        if (row->filter_verdict == FILTER_REJECT && row->py_row_dict
+                && PyDict_DelItem(py_table_dict, row->py_index_tuple) < 0)
+            return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Release state that was only needed during a walk. */
+void table_walk_finish(table_info_t* table_info) {
+    oid_map_clear(&table_info->row_cache, row_release);
+    columnar_deallocate(table_info->columnar);
+    table_info->columnar = NULL;
+}
+
+/* instance OID suffix up to which all rows have been received, NULL if there is no such bound */
+typedef struct row_bound_s {
+    oid* suffix;
+    size_t suffix_len;
+} row_bound_t;
+
+static int row_incomplete(oid_map_entry_t* entry, void* ctx) {
+    row_bound_t* bound = (row_bound_t*) ctx;
+
+    return bound->suffix
+            && snmp_oid_compare(entry->key, entry->key_len, bound->suffix, bound->suffix_len) > 0;
+}
+
+static int compare_row_entries(const void* a, const void* b) {
+    const oid_map_entry_t* ea = *(const oid_map_entry_t* const*) a;
+    const oid_map_entry_t* eb = *(const oid_map_entry_t* const*) b;
+
+    return snmp_oid_compare(ea->key, ea->key_len, eb->key, eb->key_len);
+}
+
+/*
+ * Move rows which can't get any more cells out of the row cache.
+ *
+ * Each column is walked in instance order, so a row is complete once every column that hasn't ended
+ * has reached or passed its instance OID suffix. With flush set, all cached rows are taken, e.g. when
+ * the walk stopped early. Completed rows are appended to py_rows as (index tuple, row dict), sorted by
+ * instance OID, and are released from the cache. Rows the row filter rejects are only released.
+ *
+ * Returns the number of rows appended, -1 with exception set on error.
+ */
+int table_walk_complete_rows(table_info_t* table_info, PyObject* py_rows, int flush) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    oid_map_t* row_cache = &table_info->row_cache;
+    oid_map_entry_t** entries = NULL;
+    column_t* column;
+    row_bound_t bound = { NULL, 0 };
+    size_t suffix_start;
+    size_t nr_of_rows = 0;
+    size_t nr_of_rows_appended = 0;
+    size_t i;
+    int col;
+    int ret = -1;
+
+    if (!flush) {
+        /* the least advanced column determines the bound */
+        for (col = 0; col < column_scheme->fields; col++) {
+            column = &column_scheme->column[col];
+            if (column->end)
+                continue;
+            suffix_start = column->name_length;
+            if (column->last_oid_len <= suffix_start)
+                return 0; // column has no instance yet
+            if (!bound.suffix || snmp_oid_compare(&column->last_oid[suffix_start],
+                    column->last_oid_len - suffix_start, bound.suffix, bound.suffix_len) < 0) {
+                bound.suffix = &column->last_oid[suffix_start];
+                bound.suffix_len = column->last_oid_len - suffix_start;
+            }
+        }
+    }
+
+    if (!row_cache->used)
+        return 0;
+
+    entries = malloc(row_cache->used * sizeof(oid_map_entry_t*));
+    if (!entries) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    for (i = 0; i < row_cache->size; i++) {
+        if (row_cache->slots[i].key && !row_incomplete(&row_cache->slots[i], &bound))
+            entries[nr_of_rows++] = &row_cache->slots[i];
+    }
+    qsort(entries, nr_of_rows, sizeof(oid_map_entry_t*), compare_row_entries);
+
+    for (i = 0; i < nr_of_rows; i++) {
+        row_t* row = (row_t*) entries[i]->data;
+        PyObject* py_row;
+
+        if (table_info->filter && row->filter_verdict == FILTER_UNKNOWN)
+            row->filter_verdict = filter_row(table_info->filter, row);
+        if (row->filter_verdict == FILTER_REJECT || !row->py_row_dict)
+            continue;
+        py_row = PyTuple_Pack(2, row->py_index_tuple, row->py_row_dict);
+        if (!py_row || PyList_Append(py_rows, py_row) < 0) {
+            Py_XDECREF(py_row);
+            goto done;
+        }
+        Py_DECREF(py_row);
+        nr_of_rows_appended++;
+    }
+
+    if (oid_map_retain(row_cache, row_incomplete, &bound, row_release) < 0) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    ret = (int) nr_of_rows_appended;
+
+    done:
+    free(entries);
+    return ret;
+}
+
+/*
+ * Send a walk request and wait for the response, like __send_sync_pdu.
+ * While replaying a capture, the response is the next one from the capture instead, and the
+ * request is only freed. The end of the capture looks like a timeout.
+ */
+static int walk_send(table_info_t* table_info, void* ss_opaque, netsnmp_pdu* pdu,
+        netsnmp_pdu** response, int retry_nosuch, char* err_str, int* err_num, int* err_ind) {
+    fetch_stats_t* stats = table_info->collect_stats ? &table_info->stats : NULL;
+    capture_t* capture = table_info->capture;
+    int status;
+
+    if (!capture || !capture->replaying) {
+        status = __send_sync_pdu(ss_opaque, pdu, response, retry_nosuch, err_str,
+                err_num, err_ind, stats);
+        if (capture && *response)
+            capture_record(capture, *response);
+        return status;
+    }
+
+    if (stats) {
+        /* a replayed response takes no time on the network, it goes into the first bucket */
+        stats->pdus_sent++;
+        stats->request_bytes += __pdu_encoded_size(pdu);
+        stats->rtt_hist[0]++;
+    }
+    snmp_free_pdu(pdu);
+    *response = capture_next(capture);
+    *err_num = 0;
+    *err_ind = 0;
+    memset(err_str, '\0', STR_BUF_SIZE);
+    if (!*response) {
+        *err_ind = SNMPERR_TIMEOUT;
+        strlcpy(err_str, snmp_api_errstring(SNMPERR_TIMEOUT), STR_BUF_SIZE);
+        return STAT_TIMEOUT;
+    }
+    if (stats)
+        stats->response_bytes += __pdu_encoded_size(*response);
+    if ((*response)->errstat != SNMP_ERR_NOERROR) {
+        strlcpy(err_str, (char*) snmp_errstring((*response)->errstat), STR_BUF_SIZE);
+        *err_num = (int) (*response)->errstat;
+        *err_ind = (*response)->errindex;
+    }
+    return STAT_SUCCESS;
+}
+
+/*
+ * Do one request/response round trip of a walk that was prepared with table_walk_init.
+ * Cells of the response go into py_table_dict, or only into the row cache if py_table_dict is NULL.
+ * Session error attributes are updated with the outcome.
+ *
+ * Network I/O and the decode phase of the response run with the GIL released, so other python threads
+ * make progress meanwhile. Only creating the python objects for the cells needs the GIL.
+ *
+ * *running is cleared when the walk has ended, either at the end of the table or due to an error.
+ * Returns SUCCESS, FAILURE if the walk stopped early, or an exceptional value from response_err.
+ */
+int table_walk_step(table_info_t* table_info, void* ss_opaque, PyObject *session,
+        PyObject* py_table_dict, int* running) {
+    netsnmp_pdu *pdu, *response = NULL;
+    int status;
+    int exitval = SUCCESS;
+    int walk_ret = WALK_CONTINUE;
+    int retry_nosuch = 0;
+    char err_str[STR_BUF_SIZE];
+    int err_num;
+    int err_ind;
+
+    for (;;) {
+        pdu = table_walk_request(table_info);
+        if (!pdu) {
+            DBPRT(D_DBG, ("No more columns to request\n"));
+            *running = 0;
+            break;
+        }
+
+        /*
+         * do the request
+         */
+        DBPRT(D_DBG, ("do getbulk request\n"));
+
+#ifdef NETSNMP_SINGLE_API
+        DBPRT(D_DBG, ("session (single API) - version code %lu, community %s\n", snmp_sess_session((void*)ss_opaque)->version, snmp_sess_session((void*)ss_opaque)->community));
+#else
+        DBPRT(D_DBG, ("session (traditional API) - version code %lu, community %s\n", ((netsnmp_session*)ss_opaque)->version, ((netsnmp_session*)ss_opaque)->community));
+#endif
+
+        retry_nosuch = 0; // = py_netsnmp_attr_long(session, "RetryNoSuch");
+        Py_BEGIN_ALLOW_THREADS
+        status = walk_send(table_info, ss_opaque, pdu, &response, retry_nosuch, err_str,
+                &err_num, &err_ind);
+        if (status == STAT_SUCCESS && response->errstat == SNMP_ERR_NOERROR)
+            walk_ret = table_walk_decode(table_info, response);
+        Py_END_ALLOW_THREADS
+        __py_netsnmp_update_session_errors(session, err_str, err_num, err_ind);
+
+        /* Allocates response->vars list. snmp_free_pdu destroys it at the end of the step. */
+        if (status == STAT_SUCCESS) {
+            DBPRT(D_DBG, ("got success response\n"));
+            if (response->errstat == SNMP_ERR_NOERROR) {
+                if (walk_ret == WALK_FAILURE)
+                    PyErr_NoMemory();
+                else if (table_walk_materialize(table_info, py_table_dict) < 0)
+                    walk_ret = WALK_FAILURE;
+                if (PyErr_Occurred())
+                    exitval = FAILURE_EXCEPTIONAL;
+                switch (walk_ret) {
+                case WALK_CONTINUE:
+                    break;
+                case WALK_DONE:
+                    *running = 0;
+                    break;
+                default:
+                    *running = 0;
+                    if (exitval == SUCCESS)
+                        exitval = FAILURE;
+                    break;
+                }
+            } else {
+                if (response->errstat == SNMP_ERR_NOSUCHNAME) {
+                    /* End of MIB the SNMPv1 way, for one column or all of them.
+                       Because end of MIB is OK, clear errors. */
+                    err_str[0] = '\0';
                     err_num = 0;
                     err_ind = 0;
                     __py_netsnmp_update_session_errors(session, err_str, err_num, err_ind);
+                    if (table_walk_no_such_name(table_info, response)) {
+                        /* the next request leaves the column out, that's no retry */
+                        snmp_free_pdu(response);
+                        response = NULL;
+                        continue;
+                    }
+                } else if (response->errstat == SNMP_ERR_TOOBIG && table_walk_too_big(table_info)) {
+                    /* same request again, with less repetitions */
+                    table_info->stats.retries++;
+                    snmp_free_pdu(response);
+                    response = NULL;
+                    continue;
                 } else {
                     /* Error in response, prepare exception. */
                     exitval = response_err(response);
                 }
-                running = 0;
+                *running = 0;
             }
         } else if (status == STAT_TIMEOUT) {
             DBPRT(D_DBG, ("Timeout: No Response from peer.\n"));
-            running = 0;
+            *running = 0;
             exitval = FAILURE;
         } else {
             DBPRT(D_DBG, ("got error response\n"));
-            running = 0;
+            *running = 0;
             exitval = FAILURE;
         }
-        if (response) {
-            snmp_free_pdu(response);
-            response = NULL;
-        }
+        break;
     }
 
-    if (buf) {
-        free(buf);
+    if (response)
+        snmp_free_pdu(response);
+    return exitval;
+}
+
+PyObject* table_getbulk_sub_entries(table_info_t* table_info,
+        void* ss_opaque, int max_repeaters, PyObject *session) {
+    int running = 1;
+    int exitval = SUCCESS;
+    int tmp_dont_breakdown_oids;
+    PyObject* py_table_dict = NULL;
+
+    /* Create function, transfers reference ownership. */
+    py_table_dict = PyDict_New();
+
+    /* Get table string index as string, not as dotted numbers. 1 = dont print oid indexes specially, 0 = print oid indexes specially. */
+    tmp_dont_breakdown_oids = netsnmp_ds_get_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS);
+    netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
+            NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS, 0);
+
+    table_walk_init(table_info, max_repeaters);
+
+    while (running) {
+        exitval = table_walk_step(table_info, ss_opaque, session, py_table_dict, &running);
     }
 
+    if (table_info->layout == LAYOUT_COLUMNAR && (exitval == SUCCESS || exitval == FAILURE)) {
+        Py_DECREF(py_table_dict);
+        py_table_dict = columnar_result(table_info);
+        if (!py_table_dict)
+            exitval = FAILURE_EXCEPTIONAL;
+    } else if (table_info->layout == LAYOUT_CHANGES && (exitval == SUCCESS || exitval == FAILURE)) {
+        Py_DECREF(py_table_dict);
+        py_table_dict = changes_result(table_info, exitval == SUCCESS);
+        if (!py_table_dict)
+            exitval = FAILURE_EXCEPTIONAL;
+    } else if (table_info->filter && (exitval == SUCCESS || exitval == FAILURE)) {
+        if (table_walk_filter_rows(table_info, py_table_dict) < 0)
+            exitval = FAILURE_EXCEPTIONAL;
+    }
+
+    table_walk_finish(table_info);
     netsnmp_ds_set_boolean(NETSNMP_DS_LIBRARY_ID,
             NETSNMP_DS_LIB_DONT_BREAKDOWN_OIDS, tmp_dont_breakdown_oids);
 
@@ -790,6 +2576,314 @@ PyObject* table_getbulk_sub_entries(table_info_t* table_info,
     }
 
     DBPRT(D_DBG, ("Returning exceptional.\n"));
-    Py_DECREF(py_table_dict);
+    Py_XDECREF(py_table_dict);
+    return NULL;
+}
+
+/*
+ * Set one index variable from an element of an index tuple, the inverse of create_index_tuple.
+ * Returns -1 with exception set, if the value doesn't match the index type.
+ */
+static int set_index_value(netsnmp_variable_list* var, PyObject* py_value) {
+    oid subids[MAX_OID_LEN];
+    struct in_addr addr;
+    char* str;
+    char* end;
+    Py_ssize_t len;
+    long val;
+    int nrof = 0;
+
+    switch (var->type) {
+    case ASN_INTEGER:
+    case ASN_UNSIGNED:
+    case ASN_TIMETICKS:
+    case ASN_COUNTER:
+    case ASN_UINTEGER:
+        val = PyInt_AsLong(py_value);
+        if (val == -1 && PyErr_Occurred())
+            return -1;
+        if (val < 0 && var->type != ASN_INTEGER) {
+            /* would become a huge sub-identifier */
+            PyErr_SetString(PyExc_ValueError, "unsigned index must not be negative");
+            return -1;
+        }
+        snmp_set_var_value(var, &val, sizeof(val));
+        return 0;
+
+    case ASN_OBJECT_ID:
+    case ASN_PRIV_IMPLIED_OBJECT_ID:
+        /* dotted numbers like "1.2.3.4" */
+        if (PyString_AsStringAndSize(py_value, &str, &len) < 0)
+            return -1;
+        while (*str && nrof < MAX_OID_LEN) {
+            subids[nrof++] = strtoul(str, &end, 10);
+            if (end == str || (*end && *end != '.'))
+                break;
+            str = *end ? end + 1 : end;
+        }
+        if (*str) {
+            PyErr_SetString(PyExc_ValueError, "object identifier index must be dotted numbers");
+            return -1;
+        }
+        snmp_set_var_value(var, subids, nrof * sizeof(oid));
+        return 0;
+
+    case ASN_IPADDRESS:
+        if (PyString_AsStringAndSize(py_value, &str, &len) < 0)
+            return -1;
+        if (!inet_aton(str, &addr)) {
+            PyErr_SetString(PyExc_ValueError, "IpAddress index must be in dotted notation");
+            return -1;
+        }
+        snmp_set_var_value(var, &addr.s_addr, sizeof(addr.s_addr));
+        return 0;
+
+    case ASN_OCTET_STR:
+    case ASN_PRIV_IMPLIED_OCTET_STR:
+        if (PyString_AsStringAndSize(py_value, &str, &len) < 0)
+            return -1;
+        snmp_set_var_value(var, str, len);
+        return 0;
+
+    default:
+        PyErr_SetString(PyExc_ValueError, "unsupported index type");
+        return -1;
+    }
+}
+
+/*
+ * Encode an index tuple, as found in the keys of a table dictionary, back into an instance OID suffix.
+ * A table with a single index also takes the bare index value.
+ * Returns -1 with exception set on error.
+ */
+int table_index_to_oid(table_info_t* table_info, PyObject* py_index, oid* suffix, size_t* suffix_len) {
+    netsnmp_variable_list* vars = NULL;
+    PyObject* py_seq = NULL;
+    int nrof = table_info->index_vars_nrof;
+    int ret = -1;
+    int i;
+
+    if (PyTuple_Check(py_index) || PyList_Check(py_index)) {
+        py_seq = PySequence_Fast(py_index, "index must be a tuple");
+    } else {
+        py_seq = PyTuple_Pack(1, py_index);
+    }
+    if (!py_seq)
+        return -1;
+    if (PySequence_Fast_GET_SIZE(py_seq) != nrof) {
+        PyErr_Format(PyExc_ValueError, "index must have %d values", nrof);
+        goto done;
+    }
+
+    vars = calloc(nrof ? nrof : 1, sizeof(netsnmp_variable_list));
+    if (!vars) {
+        PyErr_NoMemory();
+        goto done;
+    }
+    for (i = 0; i < nrof; i++) {
+        vars[i].type = table_info->index_vars[i].type;
+        if (i + 1 < nrof)
+            vars[i].next_variable = &vars[i + 1];
+        if (set_index_value(&vars[i], PySequence_Fast_GET_ITEM(py_seq, i)) < 0)
+            goto done;
+    }
+
+    if (build_oid_noalloc(suffix, MAX_OID_LEN - table_info->column_scheme.name_length - 1, suffix_len,
+            NULL, 0, nrof ? vars : NULL) != SNMPERR_SUCCESS) {
+        PyErr_SetString(PyExc_ValueError, "index doesn't fit into an object identifier");
+        goto done;
+    }
+    ret = 0;
+
+    done:
+    if (vars) {
+        for (i = 0; i < nrof; i++)
+            snmp_free_var_internals(&vars[i]);
+        free(vars);
+    }
+    Py_DECREF(py_seq);
+    return ret;
+}
+
+/* one requested cell of table_get_rows */
+typedef struct get_cell_s {
+    PyObject* py_index; // borrowed from the index sequence
+    column_t* column;
+    oid name[MAX_OID_LEN];
+    size_t name_len;
+} get_cell_t;
+
+/*
+ * Store the values of a GET response into py_table_dict.
+ * Cells the agent doesn't have (noSuchObject, noSuchInstance) are left out, rows without any cell too.
+ */
+static int store_get_response(table_info_t* table_info, get_cell_t* cells, netsnmp_pdu* response,
+        PyObject* py_table_dict) {
+    netsnmp_variable_list* vars;
+    PyObject* py_row_dict;
+    PyObject* py_value;
+    char buf[STR_BUF_SIZE];
+    int type, len;
+    int i;
+
+    for (vars = response->variables, i = 0; vars; vars = vars->next_variable, i++) {
+        if (vars->type == SNMP_NOSUCHOBJECT || vars->type == SNMP_NOSUCHINSTANCE
+                || vars->type == SNMP_ENDOFMIBVIEW)
+            continue;
+
+        py_row_dict = PyDict_GetItem(py_table_dict, cells[i].py_index);
+        if (!py_row_dict) {
+            py_row_dict = PyDict_New();
+            if (!py_row_dict || PyDict_SetItem(py_table_dict, cells[i].py_index, py_row_dict) < 0) {
+                Py_XDECREF(py_row_dict);
+                return FAILURE;
+            }
+            Py_DECREF(py_row_dict); // py_table_dict holds it now
+        }
+
+        if (table_info->value_mode == VALUE_MODE_NATIVE) {
+            py_value = create_native_value(vars);
+        } else {
+            len = format_value(vars, cells[i].column, table_info->sprintval_flag, buf, &type);
+            py_value = create_varbind(cells[i].column, type, buf, len);
+        }
+        if (!py_value || PyDict_SetItem(py_row_dict, cells[i].column->py_label_str, py_value) < 0) {
+            Py_XDECREF(py_value);
+            return FAILURE;
+        }
+        Py_DECREF(py_value);
+    }
+    return SUCCESS;
+}
+
+/*
+ * Fetch known rows exactly, with GET requests for each (row, selected column) pair.
+ * Up to max_varbinds cells are packed into one request. If the agent answers tooBig, the number is
+ * halved for the rest of the fetch. An SNMPv1 agent answers noSuchName for a missing instance,
+ * the cell is dropped and the request repeated without it.
+ *
+ * Returns the table dictionary, keyed by the index tuples as given in py_indexes. Py_None on error,
+ * with session errors set. NULL with exception set on python errors.
+ */
+PyObject* table_get_rows(table_info_t* table_info, void* ss_opaque, PyObject* py_indexes,
+        int max_varbinds, PyObject* session) {
+    column_scheme_t* column_scheme = &table_info->column_scheme;
+    PyObject* py_seq = NULL;
+    PyObject* py_table_dict = NULL;
+    get_cell_t* cells = NULL;
+    netsnmp_pdu *pdu, *response = NULL;
+    oid suffix[MAX_OID_LEN];
+    size_t suffix_len = 0;
+    Py_ssize_t nr_of_rows, row = 0;
+    int col = 0;
+    int nr_of_cells, pos, chunk, i;
+    int status;
+    int exitval = SUCCESS;
+    char err_str[STR_BUF_SIZE];
+    int err_num;
+    int err_ind;
+
+    if (max_varbinds < 1)
+        max_varbinds = 1;
+    memset(&table_info->stats, 0, sizeof(fetch_stats_t));
+
+    py_seq = PySequence_Fast(py_indexes, "indexes must be a sequence of index tuples");
+    if (!py_seq)
+        return NULL;
+    nr_of_rows = PySequence_Fast_GET_SIZE(py_seq);
+
+    py_table_dict = PyDict_New();
+    cells = calloc(max_varbinds, sizeof(get_cell_t));
+    if (!py_table_dict || !cells) {
+        PyErr_NoMemory();
+        exitval = FAILURE_EXCEPTIONAL;
+        goto done;
+    }
+
+    while (row < nr_of_rows && exitval == SUCCESS) {
+        /* next batch of cells, row by row */
+        for (nr_of_cells = 0; nr_of_cells < max_varbinds && row < nr_of_rows; ) {
+            column_t* column = &column_scheme->column[col];
+
+            if (col == 0 && table_index_to_oid(table_info, PySequence_Fast_GET_ITEM(py_seq, row),
+                    suffix, &suffix_len) < 0) {
+                exitval = FAILURE_EXCEPTIONAL;
+                goto done;
+            }
+            if (column->selected) {
+                get_cell_t* cell = &cells[nr_of_cells++];
+                cell->py_index = PySequence_Fast_GET_ITEM(py_seq, row);
+                cell->column = column;
+                memcpy(cell->name, column->name, column->name_length * sizeof(oid));
+                memcpy(&cell->name[column->name_length], suffix, suffix_len * sizeof(oid));
+                cell->name_len = column->name_length + suffix_len;
+            }
+            if (++col == column_scheme->fields) {
+                col = 0;
+                row++;
+            }
+        }
+
+        for (pos = 0; pos < nr_of_cells && exitval == SUCCESS; ) {
+            chunk = nr_of_cells - pos < max_varbinds ? nr_of_cells - pos : max_varbinds;
+            pdu = snmp_pdu_create(SNMP_MSG_GET);
+            for (i = pos; i < pos + chunk; i++)
+                snmp_add_null_var(pdu, cells[i].name, cells[i].name_len);
+            DBPRT(D_DBG, ("get request with %i varbinds\n", chunk));
+
+            Py_BEGIN_ALLOW_THREADS
+            status = __send_sync_pdu(ss_opaque, pdu, &response, 0, err_str, &err_num, &err_ind,
+                    table_info->collect_stats ? &table_info->stats : NULL);
+            Py_END_ALLOW_THREADS
+
+            if (status != STAT_SUCCESS) {
+                __py_netsnmp_update_session_errors(session, err_str, err_num, err_ind);
+                exitval = FAILURE;
+            } else if (response->errstat == SNMP_ERR_TOOBIG && chunk > 1) {
+                table_info->stats.too_big++;
+                table_info->stats.retries++;
+                max_varbinds = chunk / 2;
+                DBPRT(D_DBG, ("tooBig, retry with %i varbinds\n", max_varbinds));
+            } else if (response->errstat == SNMP_ERR_NOSUCHNAME
+                    && response->errindex >= 1 && response->errindex <= chunk) {
+                /* SNMPv1 agent, the instance doesn't exist */
+                table_info->stats.retries++;
+                i = pos + response->errindex - 1;
+                memmove(&cells[i], &cells[i + 1], (nr_of_cells - i - 1) * sizeof(get_cell_t));
+                nr_of_cells--;
+            } else if (response->errstat != SNMP_ERR_NOERROR) {
+                __py_netsnmp_update_session_errors(session, err_str, err_num, err_ind);
+                exitval = FAILURE;
+            } else {
+                double start = table_info->collect_stats ? __now_seconds() : 0;
+                if (store_get_response(table_info, &cells[pos], response, py_table_dict) < 0)
+                    exitval = FAILURE_EXCEPTIONAL;
+                if (table_info->collect_stats) {
+                    table_info->stats.varbinds_received += chunk;
+                    table_info->stats.materialize_seconds += __now_seconds() - start;
+                }
+                pos += chunk;
+            }
+            if (response) {
+                snmp_free_pdu(response);
+                response = NULL;
+            }
+        }
+    }
+    if (exitval == SUCCESS) {
+        err_str[0] = '\0';
+        __py_netsnmp_update_session_errors(session, err_str, 0, 0);
+    }
+
+    done:
+    free(cells);
+    Py_DECREF(py_seq);
+    if (exitval == SUCCESS)
+        return py_table_dict;
+    Py_XDECREF(py_table_dict);
+    if (exitval == FAILURE) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
     return NULL;
 }
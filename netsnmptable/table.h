@@ -4,24 +4,38 @@
 #include <Python.h>
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
+#include "util.h"
+#include "oidmap.h"
 
 /* column specific data - one per column */
 typedef struct column_s {
     oid subid; // The table column ID. Assumes that the innermost index is an integer. How to deal with tables where this is a string index? Can it work at all?
+    oid name[MAX_OID_LEN]; // column OID, conceptual row OID of its table and subid, instances follow
+    size_t name_length;
     PyObject* py_label_str;
+    // MIB information, resolved once in table_get_field_names
+    struct tree *tp; // MIB node of the column, NULL if the column is not known from MIB
+    int is_leaf;
+    int type;
+    char type_str[MAX_TYPE_NAME_LEN];
     // for response PDU tracking
     oid last_oid[MAX_OID_LEN];
     size_t last_oid_len;
     netsnmp_variable_list *last_var; // most recent varbind for this column in a getbulk response
     char end;
+    char selected; // column is part of the fetch, see table_select_columns
+    char filter_only; // selected only for the row filter, its cells are not part of the rows
 } column_t;
 
 /* column general data - one per table */
 typedef struct column_scheme_s {
-    oid name[MAX_OID_LEN];
+    oid name[MAX_OID_LEN];   // conceptual row OID, the longest one of a table group
     size_t name_length;
     oid start_idx[MAX_OID_LEN];
     size_t start_idx_length;
+    oid end_idx[MAX_OID_LEN];  // upper bound of the instance OID suffix, inclusive
+    size_t end_idx_length;     // 0 if there is no upper bound
+    int end_idx_complete;      // end_idx specifies all indexes, not only a prefix
     int fields;
     column_t* column;
     column_t** position_map; // maps column by number in response to a column entry
@@ -33,21 +47,176 @@ typedef struct index_scheme_s {
 	int val_len;
 } index_scheme_t;
 
+/* representation of cell values in the result dictionary */
+#define VALUE_MODE_VARBIND 0 // netsnmp.Varbind objects with type and val as strings
+#define VALUE_MODE_NATIVE 1  // plain python int/long/str/tuple objects, taken directly from vars->val
+#define VALUE_MODE_RATE 2    // (delta, rate) of counter cells since the previous poll, native values otherwise.
+                             // A TimeTicks value of the first scalar is taken as agent uptime.
+
+/* layout of the fetch result */
+#define LAYOUT_ROWS 0     // dictionary of row dictionaries
+#define LAYOUT_COLUMNAR 1 // one typed array per column, see columnar.h
+#define LAYOUT_CHANGES 2  // rows added, changed and removed since the previous walk, see changes.h
+
+/* one index value of a row, parsed from the instance OID suffix without the GIL */
+typedef struct index_value_s {
+    unsigned char type;
+    long integer;      // integer types
+    size_t start;      // octets or sub-identifiers of the other types, offset behind the index value array
+    size_t len;        // in bytes
+} index_value_t;
+
+/* row cache payload - decoded index and row dictionary of one instance OID suffix */
+typedef struct row_s {
+    index_value_t* index;  // decoded by table_walk_decode, NULL if not yet
+    PyObject* py_index_tuple;
+    PyObject* py_row_dict;
+    size_t nr;         // order of row creation, only used by the columnar and changes layouts
+    uint64_t hash;     // sum of the cell hashes, only used by the changes layout
+    uint64_t filter_atoms; // filter atoms that hold for the cells seen, see filter.h
+    uint64_t filter_seen;  // filter columns that delivered their cell
+    char filter_verdict;   // FILTER_UNKNOWN until the filter columns have passed the row
+} row_t;
+
+/* previous value of a counter cell, for VALUE_MODE_RATE */
+typedef struct rate_state_s {
+    unsigned PY_LONG_LONG value;
+    double time;              // when the response with value arrived
+    unsigned long generation; // rate poll that last saw the cell
+} rate_state_t;
+
+/* row of the previous walk, for LAYOUT_CHANGES */
+typedef struct snapshot_s {
+    uint64_t hash;
+    unsigned long generation; // walk that last saw the row
+} snapshot_t;
+
+struct columnar_s;
+struct filter_s;
+struct capture_s;
+
+/* cell of a response, decoded without holding the GIL, see table_walk_decode */
+typedef struct decoded_cell_s {
+    column_t* column;
+    row_t* row;                  // row cache entry, its python objects may not exist yet
+    netsnmp_variable_list* vars; // response varbind, valid until the response is freed
+    int type;                    // VALUE_MODE_VARBIND: translated type, and formatted value in text
+    size_t text_start;
+    int text_len;
+} decoded_cell_t;
+
+typedef struct decode_buf_s {
+    decoded_cell_t* cell;
+    size_t nr_of_cells;
+    size_t size;
+    char* text;
+    size_t text_len;
+    size_t text_size;
+    netsnmp_variable_list* scalar_vars; // first varbind answering the scalars, see table_set_scalars
+    int nr_of_scalar_vars;
+} decode_buf_t;
+
+/* scalar that is requested along with the first request of a walk, see table_set_scalars */
+typedef struct scalar_s {
+    oid name[MAX_OID_LEN];    // the scalar instance, e.g. sysUpTime.0
+    size_t name_len;
+    oid request[MAX_OID_LEN]; // an OID just before name, non-repeaters and GETNEXT return the successor
+    size_t request_len;
+} scalar_t;
+
+/* upper bound for max-repetitions in adaptive mode */
+#define ADAPTIVE_MAX_REPEATERS 1024
+
+/* max-repetitions control of getbulk requests - one per walk */
+typedef struct repeaters_s {
+    int adaptive;   // follow the agent's message size, or always request the initial max_repeaters
+    int current;    // max-repetitions of the next request
+    int requested;  // max-repetitions of the most recent request
+    int vb_ceiling; // smallest number of varbinds known not to fit into one response, 0 if unknown
+} repeaters_t;
+
 typedef struct t_info_s {
     oid root[MAX_OID_LEN];
     size_t rootlen;
     char *table_name;
     int getlabel_flag;
     int sprintval_flag;
+    int value_mode;
+    int layout;
     column_scheme_t column_scheme;
     index_scheme_t* index_vars;
     int index_vars_nrof;
+    oid_map_t row_cache; // instance OID suffix -> row_t, valid during one fetch
+    int nr_of_requested_columns; // columns in the most recent request
+    repeaters_t repeaters;
+    struct columnar_s* columnar; // cells collected by a columnar walk
+    decode_buf_t decode_buf;     // cells of the most recent response, between decode and materialize
+    char resume;                 // next walk continues from the column state set by table_set_cursor
+    char use_getnext;            // walk with GETNEXT, for SNMPv1 agents which don't know GETBULK
+    char collect_stats;          // count into stats during fetches
+    fetch_stats_t stats;         // of the most recent fetch, see table_get_stats
+    struct capture_s* capture;   // records the responses of a fetch, or replays them, see capture.h
+    oid_map_t rate_state;        // cell OID -> rate_state_t, kept between polls
+    scalar_t* scalars;           // requested as non-repeaters in the first request of a walk
+    int nr_of_scalars;
+    int scalars_requested;       // scalars in the most recent request
+    char scalars_pending;        // no response has answered the scalars yet
+    PyObject* py_scalar_values;  // tuple with one value per scalar, once received
+    unsigned long rate_generation; // number of the current rate poll
+    unsigned long rate_uptime;   // agent uptime in TimeTicks at the previous rate poll, if known
+    char rate_uptime_known;
+    oid_map_t snapshot;          // instance OID suffix -> snapshot_t, kept between walks
+    unsigned long snapshot_generation; // number of the current changes walk
+    struct filter_s* filter;     // rows to keep, evaluated while decoding, see filter.h
 } table_info_t;
 
+/* table name for messages, never NULL */
+#define TABLE_NAME(table_info) ((table_info)->table_name ? (table_info)->table_name : "table")
+
+/* return values of table_walk_response */
+#define WALK_FAILURE (-1)
+#define WALK_DONE 0
+#define WALK_CONTINUE 1
+
 extern table_info_t* table_allocate(char* tablename);
+extern table_info_t* table_allocate_oid(oid* root, size_t rootlen);
+extern int table_set_oid_name(table_info_t* table_info);
+extern int table_add_column(table_info_t* table_info, oid subid, PyObject* py_label, int type);
+extern int table_add_index(table_info_t* table_info, unsigned char type, int val_len);
+extern int table_type_from_str(const char* str);
+extern int table_complete_columns(table_info_t* table_info);
 extern void table_deallocate(table_info_t* table);
+extern table_info_t* table_clone(table_info_t* table);
+extern table_info_t* table_group(table_info_t** tables, int nr_of_tables);
 extern int table_get_field_names(table_info_t* table_info);
+extern int table_select_columns(table_info_t* table_info, PyObject* py_names);
+extern PyObject* table_get_column_oids(table_info_t* table_info);
+extern PyObject* table_get_cursor(table_info_t* table_info);
+extern PyObject* table_get_stats(table_info_t* table_info);
+extern int table_set_cursor(table_info_t* table_info, PyObject* py_cursor);
+extern int table_set_scalars(table_info_t* table_info, PyObject* py_scalars);
+extern PyObject* table_get_scalar_values(table_info_t* table_info);
+extern void table_walk_init(table_info_t* table_info, int max_repeaters);
+extern netsnmp_pdu* table_walk_request(table_info_t* table_info);
+extern int table_walk_decode(table_info_t* table_info, netsnmp_pdu* response);
+extern int table_walk_materialize(table_info_t* table_info, PyObject* py_table_dict);
+extern int table_walk_response(table_info_t* table_info, netsnmp_pdu* response,
+        PyObject* py_table_dict);
+extern int table_walk_too_big(table_info_t* table_info);
+extern void table_rates_begin(table_info_t* table_info);
+extern int table_rates_prune(table_info_t* table_info);
+extern void table_rates_reset(table_info_t* table_info);
+extern int table_walk_no_such_name(table_info_t* table_info, netsnmp_pdu* response);
+extern int table_walk_filter_rows(table_info_t* table_info, PyObject* py_table_dict);
+extern void table_walk_finish(table_info_t* table_info);
+extern int table_walk_step(table_info_t* table_info, void* ss_opaque, PyObject *session,
+        PyObject* py_table_dict, int* running);
+extern int table_walk_complete_rows(table_info_t* table_info, PyObject* py_rows, int flush);
 extern PyObject* table_getbulk_sub_entries(table_info_t* table_info,
 		void* ss_opaque, int max_repeaters, PyObject *session);
+extern PyObject* create_index_tuple(oid* start, int max_oid_len, index_scheme_t *index_varlist, int nr_of_index);
+extern int table_index_to_oid(table_info_t* table_info, PyObject* py_index, oid* suffix, size_t* suffix_len);
+extern PyObject* table_get_rows(table_info_t* table_info, void* ss_opaque, PyObject* py_indexes,
+        int max_varbinds, PyObject* session);
 
 #endif /* SNMPTABLE_H_ */
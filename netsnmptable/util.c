@@ -19,6 +19,7 @@ typedef int Py_ssize_t;
 #endif
 #include <netdb.h>
 #include <stdlib.h>
+#include <time.h>
 
 #ifdef HAVE_REGEX_H
 #include <regex.h>
@@ -377,14 +378,198 @@ int __is_leaf(tp)
                     || (tp->parent && __get_type_str(tp->parent->type, buf))));
 }
 
+/* Monotonic clock in seconds, for fetch statistics. */
+double __now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* size of a BER length field */
+static size_t ber_len_size(size_t len) {
+    size_t size = 1;
+
+    if (len >= 0x80) {
+        for (; len; len >>= 8)
+            size++;
+    }
+    return size;
+}
+
+static size_t ber_tlv_size(size_t content_len) {
+    return 1 + ber_len_size(content_len) + content_len;
+}
+
+/* content size of an unsigned integer, with a leading zero octet if the high bit is set */
+static size_t ber_uint_size(unsigned long long val) {
+    size_t size = 1;
+
+    for (; val > 0x7f; val >>= 8)
+        size++;
+    return size;
+}
+
+static size_t ber_int_size(long val) {
+    return val < 0 ? ber_uint_size(~(unsigned long long) val) : ber_uint_size(val);
+}
+
+static size_t ber_oid_size(oid* name, size_t len) {
+    size_t size = 1; // first two sub-identifiers
+    size_t i;
+    oid subid;
+
+    for (i = 2; i < len; i++) {
+        for (subid = name[i], size++; subid > 0x7f; subid >>= 7)
+            size++;
+    }
+    return size;
+}
+
+/*
+ * BER encoded size of a PDU, without the message header (version, community or USM parameters).
+ * Computed from the varbinds, without encoding anything.
+ */
+size_t __pdu_encoded_size(netsnmp_pdu *pdu) {
+    netsnmp_variable_list *vars;
+    size_t vbl_len = 0;
+    size_t val_len;
+
+    for (vars = pdu->variables; vars; vars = vars->next_variable) {
+        switch (vars->type) {
+        case ASN_INTEGER:
+            val_len = ber_int_size(*vars->val.integer);
+            break;
+        case ASN_COUNTER:
+        case ASN_GAUGE:
+        case ASN_TIMETICKS:
+        case ASN_UINTEGER:
+            val_len = ber_uint_size((u_long) *vars->val.integer);
+            break;
+        case ASN_COUNTER64:
+            val_len = ber_uint_size(((unsigned long long) vars->val.counter64->high << 32)
+                    | vars->val.counter64->low);
+            break;
+        case ASN_OBJECT_ID:
+            val_len = ber_oid_size(vars->val.objid, vars->val_len / sizeof(oid));
+            break;
+        case ASN_NULL:
+        case SNMP_ENDOFMIBVIEW:
+        case SNMP_NOSUCHOBJECT:
+        case SNMP_NOSUCHINSTANCE:
+            val_len = 0;
+            break;
+        default:
+            val_len = vars->val_len;
+            break;
+        }
+        vbl_len += ber_tlv_size(ber_tlv_size(ber_oid_size(vars->name, vars->name_length))
+                + ber_tlv_size(val_len));
+    }
+    /* request-id, error-status or non-repeaters, error-index or max-repetitions */
+    return ber_tlv_size(ber_tlv_size(ber_int_size(pdu->reqid))
+            + ber_tlv_size(ber_int_size(pdu->errstat))
+            + ber_tlv_size(ber_int_size(pdu->errindex))
+            + ber_tlv_size(vbl_len));
+}
+
+/*
+ * Helpers for the binary formats of schema.c and capture.c.
+ * Integers are 32 bit in network byte order, OIDs are prefixed with their length.
+ */
+void __buf_put_bytes(byte_buf_t* buf, const void* bytes, size_t len) {
+    char* data;
+    size_t cap;
+
+    if (buf->failed)
+        return;
+    if (buf->len + len > buf->cap) {
+        cap = buf->cap ? buf->cap * 2 : 256;
+        while (cap < buf->len + len)
+            cap *= 2;
+        data = realloc(buf->data, cap);
+        if (!data) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = data;
+        buf->cap = cap;
+    }
+    memcpy(buf->data + buf->len, bytes, len);
+    buf->len += len;
+}
+
+void __buf_put_u32(byte_buf_t* buf, uint32_t val) {
+    val = htonl(val);
+    __buf_put_bytes(buf, &val, sizeof(val));
+}
+
+void __buf_put_oid(byte_buf_t* buf, const oid* name, size_t len) {
+    size_t i;
+
+    __buf_put_u32(buf, (uint32_t) len);
+    for (i = 0; i < len; i++)
+        __buf_put_u32(buf, (uint32_t) name[i]);
+}
+
+/* Returns the next len bytes, NULL if there are less left */
+const char* __buf_get_bytes(byte_reader_t* rd, size_t len) {
+    const char* bytes;
+
+    if (rd->failed || len > rd->len - rd->pos) {
+        rd->failed = 1;
+        return NULL;
+    }
+    bytes = rd->data + rd->pos;
+    rd->pos += len;
+    return bytes;
+}
+
+uint32_t __buf_get_u32(byte_reader_t* rd) {
+    const char* bytes = __buf_get_bytes(rd, sizeof(uint32_t));
+    uint32_t val;
+
+    if (!bytes)
+        return 0;
+    memcpy(&val, bytes, sizeof(val));
+    return ntohl(val);
+}
+
+/* name must hold MAX_OID_LEN subids. Returns the OID length. */
+size_t __buf_get_oid(byte_reader_t* rd, oid* name) {
+    uint32_t len = __buf_get_u32(rd);
+    uint32_t i;
+
+    if (len > MAX_OID_LEN) {
+        rd->failed = 1;
+        return 0;
+    }
+    for (i = 0; i < len; i++)
+        name[i] = __buf_get_u32(rd);
+    return len;
+}
+
+static void count_round_trip(fetch_stats_t *stats, double seconds) {
+    double ms = seconds * 1000;
+    int bucket = 0;
+
+    while (bucket < STATS_RTT_BUCKETS - 1 && ms >= (double) (1 << bucket))
+        bucket++;
+    stats->rtt_hist[bucket]++;
+    stats->network_seconds += seconds;
+}
+
 /* takes ss and pdu as input and updates the 'response' argument */
 /* the input 'pdu' argument will be freed */
+/* must be called without holding the GIL, it blocks until the response arrives */
+/* stats receives counters and round trip times if not NULL */
 int __send_sync_pdu(void *ss, netsnmp_pdu *pdu,
         netsnmp_pdu **response, int retry_nosuch, char *err_str, int *err_num,
-        int *err_ind) {
+        int *err_ind, fetch_stats_t *stats) {
     int status = 0;
     long command = pdu->command;
     char *tmp_err_str;
+    double start = 0;
 
     *err_num = 0;
     *err_ind = 0;
@@ -400,19 +585,26 @@ int __send_sync_pdu(void *ss, netsnmp_pdu *pdu,
     }
     retry:
 
-    Py_BEGIN_ALLOW_THREADS
-
     /* NetSNMP in 5.4.x used to open session with ss = snmp_open(&session) for SNMPv1/v2,
      * but they changed to ss = snmp_sess_open(&session) with 5.5.
      * TODO: We probably have no chance to detect which API call was used to get the session pointer,
      * and have to introduce our own session.
      */
+    if (stats) {
+        stats->pdus_sent++;
+        stats->request_bytes += __pdu_encoded_size(pdu);
+        start = __now_seconds();
+    }
 #ifdef NETSNMP_SINGLE_API
     status = snmp_sess_synch_response(ss, pdu, response);
 #else
     status = snmp_synch_response((netsnmp_session*) ss, pdu, response);
 #endif
-    Py_END_ALLOW_THREADS
+    if (stats) {
+        count_round_trip(stats, __now_seconds() - start);
+        if (*response)
+            stats->response_bytes += __pdu_encoded_size(*response);
+    }
 
     if ((*response == NULL) && (status == STAT_SUCCESS))
         status = STAT_ERROR;
@@ -427,6 +619,8 @@ int __send_sync_pdu(void *ss, netsnmp_pdu *pdu,
             if (retry_nosuch && (pdu = snmp_fix_pdu(*response, command))) {
                 if (*response)
                     snmp_free_pdu(*response);
+                if (stats)
+                    stats->retries++;
                 goto retry;
             }
 
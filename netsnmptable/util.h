@@ -1,6 +1,7 @@
 #ifndef UTIL_H_
 #define UTIL_H_
 
+#include <stdint.h>
 #include <net-snmp/net-snmp-config.h>
 #include <net-snmp/net-snmp-includes.h>
 
@@ -38,6 +39,47 @@ extern int _debug_level;
 #define STR_BUF_SIZE (MAX_TYPE_NAME_LEN * MAX_OID_LEN)
 #define MAX_TYPE_NAME_LEN 32
 
+/* round trip time histogram, bucket i counts round trips below 2^i ms, the last bucket all longer ones */
+#define STATS_RTT_BUCKETS 12
+
+/* max-repetitions are recorded for this many requests of a fetch */
+#define STATS_REPETITIONS 64
+
+/* counters of one fetch, only collected if requested */
+typedef struct fetch_stats_s {
+    unsigned long pdus_sent;
+    unsigned long request_bytes;      // BER encoded size of the PDUs, without message header
+    unsigned long response_bytes;
+    unsigned long rtt_hist[STATS_RTT_BUCKETS];
+    unsigned long varbinds_received;
+    unsigned long varbinds_discarded; // past the end of the table or range, or of another column
+    unsigned long retries;            // requests repeated after tooBig or noSuchName, not SNMPv1 column ends
+    unsigned long too_big;
+    unsigned long index_tuples;       // rows decoded into an index tuple and row dictionary
+    unsigned long cells_stored;       // values stored into row dictionaries
+    int max_repetitions[STATS_REPETITIONS]; // of the requests in order, 1 for GETNEXT
+    unsigned long nr_of_repetitions;  // requests recorded in max_repetitions
+    double network_seconds;           // waiting for responses
+    double decode_seconds;            // response parsing without the GIL
+    double materialize_seconds;       // creating python objects
+} fetch_stats_t;
+
+/* growable output buffer, see __buf_put_bytes. failed is set once out of memory, later writes are dropped */
+typedef struct byte_buf_s {
+    char* data;
+    size_t len;
+    size_t cap;
+    int failed;
+} byte_buf_t;
+
+/* input cursor, see __buf_get_bytes. failed is set once the data is exhausted */
+typedef struct byte_reader_s {
+    const char* data;
+    size_t len;
+    size_t pos;
+    int failed;
+} byte_reader_t;
+
 #define NO_FLAGS 0x00
 #define USE_NUMERIC_OIDS 0x08
 #define USE_LONG_NAMES 0x02
@@ -60,9 +102,17 @@ extern int __snprint_value(char* buf, size_t buf_len,
 extern int __get_type_str(int type, char* str);
 extern int __translate_asn_type(int type);
 extern int __is_leaf(struct tree* tp);
+extern double __now_seconds(void);
+extern size_t __pdu_encoded_size(netsnmp_pdu *pdu);
+extern void __buf_put_bytes(byte_buf_t* buf, const void* bytes, size_t len);
+extern void __buf_put_u32(byte_buf_t* buf, uint32_t val);
+extern void __buf_put_oid(byte_buf_t* buf, const oid* name, size_t len);
+extern const char* __buf_get_bytes(byte_reader_t* rd, size_t len);
+extern uint32_t __buf_get_u32(byte_reader_t* rd);
+extern size_t __buf_get_oid(byte_reader_t* rd, oid* name);
 extern int __send_sync_pdu(void *ss, netsnmp_pdu *pdu,
         netsnmp_pdu **response, int retry_nosuch, char *err_str, int *err_num,
-        int *err_ind);
+        int *err_ind, fetch_stats_t *stats);
 extern void __py_netsnmp_update_session_errors(PyObject *session, char *err_str,
         int err_num, int err_ind);
 
@@ -47,7 +47,10 @@ setup(
     packages=['netsnmptable'],
     test_suite = "tests.test",
     ext_modules = [
-       Extension("netsnmptable.interface", ["netsnmptable/interface.c", "netsnmptable/table.c", "netsnmptable/util.c"],
+       Extension("netsnmptable.interface", ["netsnmptable/interface.c", "netsnmptable/table.c", "netsnmptable/util.c",
+                  "netsnmptable/oidmap.c", "netsnmptable/poller.c", "netsnmptable/iterator.c",
+                  "netsnmptable/columnar.c", "netsnmptable/schema.c", "netsnmptable/capture.c",
+                  "netsnmptable/changes.c", "netsnmptable/filter.c"],
                  library_dirs=libdirs,
                  include_dirs=incdirs,
                  libraries=libs,
@@ -0,0 +1,335 @@
+""" Measures table fetch throughput against the in-process test agent.
+
+Usage: python tests/benchmark.py [rows] [loops]
+       python tests/benchmark.py --suite [--loops 3] [--table-rows 1000,100000] [--table-columns 2,50]
+           [--index-kinds integer,string,multi] [--repeaters 10,25,50] [--value-modes varbind,native]
+
+Without --suite, prints a human readable report on singleIdxTable.
+With --suite, walks every table shape with every max_repeaters value and value mode, and prints
+one JSON object per line. Populating the agent with 100k rows and 50 columns takes some minutes.
+"""
+
+import argparse
+import ctypes
+import json
+import netsnmp
+import netsnmptable
+import os
+import resource
+import shutil
+import subprocess
+import sys
+import tempfile
+import testagent
+import threading
+import time
+
+os.environ['MIBDIRS'] = os.path.dirname(os.path.abspath(__file__)) + ":/usr/share/mibs/ietf"
+testagent.configure(agent_address = "localhost:1235",
+    rocommunity='public', rwcommunity='private')
+
+def setup_oids(rows):
+    singleIdxTable = testagent.Table(
+        oidstr = "TEST-MIB::singleIdxTable",
+        indexes = [
+            testagent.DisplayString()
+        ],
+        columns = [
+            (2, testagent.DisplayString("")),
+            (3, testagent.Integer32(0))
+        ],
+    )
+    for i in range(rows):
+        row = singleIdxTable.addRow([testagent.DisplayString("Row%06d" % i)])
+        row.setRowCell(2, testagent.DisplayString("ContentOfRow%06d" % i))
+        row.setRowCell(3, testagent.Integer32(i))
+
+def row_cache_stats(session):
+    """Fetch singleIdxTable once with statistics, return the stats dictionary."""
+    table = session.table_from_mib('TEST-MIB::singleIdxTable')
+    table.get_entries(max_repeaters=50, value_mode="native", stats=True)
+    if session.ErrorNum:
+        raise RuntimeError(session.ErrorStr)
+    return table.stats
+
+def measure(session, loops, **kwargs):
+    """Fetch singleIdxTable loops times, return (rows, cells, seconds) of the fastest run."""
+    table = session.table_from_mib('TEST-MIB::singleIdxTable')
+    best = None
+    rows = cells = 0
+    for _ in range(loops):
+        start = time.time()
+        tbldict = table.get_entries(**kwargs)
+        elapsed = time.time() - start
+        if session.ErrorNum:
+            raise RuntimeError(session.ErrorStr)
+        rows = len(tbldict)
+        cells = sum(len(row) for row in tbldict.values())
+        best = elapsed if best is None else min(best, elapsed)
+    return rows, cells, best
+
+def background_progress(session, loops):
+    """Count loop iterations of another python thread while fetching, return iterations per second.
+    The fetch only holds the GIL while it creates python objects, so the thread keeps running."""
+    state = {'running': True, 'count': 0}
+    def spin():
+        while state['running']:
+            state['count'] += 1
+    thread = threading.Thread(target=spin)
+    thread.start()
+    try:
+        rows, cells, seconds = measure(session, loops, max_repeaters=50)
+    finally:
+        state['running'] = False
+        thread.join()
+    return state['count'] / (seconds * loops)
+
+def replay_decode(session, loops, value_mode):
+    """Record one walk of singleIdxTable, then replay it loops times without network.
+    Return (cells, seconds) of the fastest replay, which is the decode and materialize cost alone."""
+    table = session.table_from_mib('TEST-MIB::singleIdxTable')
+    fd, path = tempfile.mkstemp()
+    os.close(fd)
+    try:
+        table.get_entries(max_repeaters=50, value_mode=value_mode, record=path)
+        best = None
+        for _ in range(loops):
+            start = time.time()
+            tbldict = table.get_entries(max_repeaters=50, value_mode=value_mode, replay=path)
+            elapsed = time.time() - start
+            best = elapsed if best is None else min(best, elapsed)
+        return sum(len(row) for row in tbldict.values()), best
+    finally:
+        os.remove(path)
+
+# child process for schema_startup, prints seconds for table creation and max RSS in kB
+STARTUP_SCRIPT = """
+import resource, sys, time
+start = time.time()
+import netsnmp, netsnmptable
+session = netsnmp.Session(Version=2, DestHost='localhost:1235', Community='public')
+if sys.argv[1] == 'mib':
+    table = session.table_from_mib('TEST-MIB::singleIdxTable')
+else:
+    table = session.table_from_schema_file(sys.argv[1])
+print(time.time() - start, resource.getrusage(resource.RUSAGE_SELF).ru_maxrss)
+"""
+
+def schema_startup(session):
+    """Start fresh processes that create the table from MIB, or from a schema file without loading
+    any MIB. Return {label: (seconds, max RSS in kB)}."""
+    tmpdir = tempfile.mkdtemp()
+    try:
+        path = os.path.join(tmpdir, 'singleIdxTable.schema')
+        session.table_from_mib('TEST-MIB::singleIdxTable').save_schema(path)
+        nomib_env = dict(os.environ, MIBS='', MIBDIRS=tmpdir)
+        results = {}
+        for label, arg, env in (("from MIB", "mib", os.environ), ("from schema file", path, nomib_env)):
+            out = subprocess.check_output([sys.executable, '-c', STARTUP_SCRIPT, arg], env=env)
+            seconds, rss = out.split()[-2:]
+            results[label] = (float(seconds), int(rss))
+        return results
+    finally:
+        shutil.rmtree(tmpdir)
+
+# suite tables are registered below this OID, as <SUITE_ROOT>.<n>, no MIB needed
+SUITE_ROOT = ".1.3.6.1.4.99999.9"
+
+# index syntax of the agent objects and the client schema, per index kind
+INDEX_KINDS = {
+    'integer': ["INTEGER"],
+    'string': ["OCTETSTR"],
+    'multi': ["OCTETSTR", "INTEGER"],
+}
+
+def suite_index(kind, i):
+    """Return agent index objects of row i."""
+    if kind == 'integer':
+        return [testagent.Integer32(i + 1)]
+    if kind == 'string':
+        return [testagent.DisplayString("Row%06d" % i)]
+    return [testagent.DisplayString("Group%04d" % (i // 100)), testagent.Integer32(i % 100 + 1)]
+
+def suite_columns(nr_of_columns):
+    """Return {subid: (name, syntax)}, alternating string and integer columns from subid 2."""
+    return dict((col + 2, ("column%02d" % (col + 2), "OCTETSTR" if col % 2 == 0 else "INTEGER"))
+                for col in range(nr_of_columns))
+
+def setup_suite_oids(shapes):
+    """Register one agent table per (rows, columns, index kind) shape, return {shape: root oid}."""
+    roots = {}
+    for n, (rows, nr_of_columns, kind) in enumerate(shapes):
+        root = "%s.%d" % (SUITE_ROOT, n + 1)
+        columns = suite_columns(nr_of_columns)
+        agent_table = testagent.Table(
+            oidstr = root + ".1",
+            indexes = [testagent.Integer32() if syntax == "INTEGER" else testagent.DisplayString()
+                       for syntax in INDEX_KINDS[kind]],
+            columns = [(subid, testagent.DisplayString("") if syntax == "OCTETSTR" else testagent.Integer32(0))
+                       for subid, (name, syntax) in sorted(columns.items())],
+        )
+        for i in range(rows):
+            row = agent_table.addRow(suite_index(kind, i))
+            for subid, (name, syntax) in columns.items():
+                if syntax == "OCTETSTR":
+                    row.setRowCell(subid, testagent.DisplayString("Row%06dColumn%02d" % (i, subid)))
+                else:
+                    row.setRowCell(subid, testagent.Integer32(i * subid))
+        roots[(rows, nr_of_columns, kind)] = root
+    return roots
+
+class _Timeval(ctypes.Structure):
+    _fields_ = [("tv_sec", ctypes.c_long), ("tv_usec", ctypes.c_long)]
+
+class _Rusage(ctypes.Structure):
+    _fields_ = [("ru_utime", _Timeval), ("ru_stime", _Timeval), ("ru_other", ctypes.c_long * 14)]
+
+RUSAGE_THREAD = 1
+
+def thread_cpu_seconds():
+    """CPU time of the calling thread. The agent runs in another thread of this process, so
+    process CPU time would include the agent's work. Falls back to process CPU time."""
+    usage = _Rusage()
+    try:
+        if ctypes.CDLL(None).getrusage(RUSAGE_THREAD, ctypes.byref(usage)) == 0:
+            return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+                    (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6)
+    except (OSError, AttributeError):
+        pass
+    usage = resource.getrusage(resource.RUSAGE_SELF)
+    return usage.ru_utime + usage.ru_stime
+
+def reset_peak_rss():
+    """Reset the peak RSS of this process, where Linux supports it (>= 4.0)."""
+    try:
+        with open("/proc/self/clear_refs", "w") as clear_refs:
+            clear_refs.write("5")
+    except IOError:
+        pass
+
+def rss_kb():
+    """Return (current RSS, peak RSS) in kB. Current RSS is 0 where /proc is not available."""
+    try:
+        with open("/proc/self/status") as status:
+            fields = dict(line.split(":", 1) for line in status if ":" in line)
+        return int(fields["VmRSS"].split()[0]), int(fields["VmHWM"].split()[0])
+    except (IOError, KeyError, ValueError):
+        return 0, resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+
+def suite_measure(session, root, shape, max_repeaters, value_mode, loops):
+    """Fetch one table shape loops times, return a result dict of the fastest run.
+    Peak RSS is the highest of all runs, including the agent and the previously fetched tables."""
+    rows, nr_of_columns, kind = shape
+    table = netsnmptable.Table.from_schema(session, root, suite_columns(nr_of_columns), INDEX_KINDS[kind])
+    result = None
+    peak_rss = rss_growth = 0
+    for _ in range(loops):
+        reset_peak_rss()
+        rss_before = rss_kb()[0]
+        cpu_start = thread_cpu_seconds()
+        start = time.time()
+        tbldict = table.get_entries(max_repeaters=max_repeaters, value_mode=value_mode, stats=True)
+        elapsed = time.time() - start
+        cpu = thread_cpu_seconds() - cpu_start
+        rss_after, rss_peak = rss_kb()
+        if session.ErrorNum:
+            raise RuntimeError(session.ErrorStr)
+        if len(tbldict) != rows:
+            raise RuntimeError("fetched %d of %d rows" % (len(tbldict), rows))
+        del tbldict
+        peak_rss = max(peak_rss, rss_peak)
+        if rss_before:
+            rss_growth = max(rss_growth, rss_peak - rss_before)
+        if result is None or elapsed < result['seconds']:
+            result = {
+                'rows': rows,
+                'columns': nr_of_columns,
+                'index': kind,
+                'max_repeaters': max_repeaters,
+                'value_mode': value_mode,
+                'seconds': elapsed,
+                'rows_per_second': rows / elapsed,
+                'pdus': table.stats['pdus_sent'],
+                'request_bytes': table.stats['request_bytes'],
+                'response_bytes': table.stats['response_bytes'],
+                'cpu_seconds_per_row': cpu / rows,
+            }
+    result['peak_rss_kb'] = peak_rss
+    result['rss_growth_kb'] = rss_growth
+    return result
+
+def int_list(arg):
+    return [int(item) for item in arg.split(",")]
+
+def str_list(arg):
+    return arg.split(",")
+
+def run_suite(args):
+    shapes = [(rows, columns, kind) for rows in args.table_rows for columns in args.table_columns
+              for kind in args.index_kinds]
+    for kind in args.index_kinds:
+        if kind not in INDEX_KINDS:
+            raise SystemExit("unknown index kind %s, use one of %s" % (kind, ",".join(sorted(INDEX_KINDS))))
+    roots = setup_suite_oids(shapes)
+    testagent.start_server()
+    try:
+        session = netsnmp.Session(Version=2, DestHost='localhost:1235', Community='public')
+        for shape in shapes:
+            for max_repeaters in args.repeaters:
+                for value_mode in args.value_modes:
+                    result = suite_measure(session, roots[shape], shape, max_repeaters, value_mode, args.loops)
+                    print(json.dumps(result, sort_keys=True))
+                    sys.stdout.flush()
+    finally:
+        testagent.stop_server()
+
+def main():
+    parser = argparse.ArgumentParser(description="Measure table fetch throughput against the test agent.")
+    parser.add_argument('rows', nargs='?', type=int, default=1000, help="rows of singleIdxTable in the report")
+    parser.add_argument('loops', nargs='?', type=int, default=3, help="fetches per measurement, the fastest counts")
+    parser.add_argument('--suite', action='store_true', help="print JSON lines for all table shapes instead")
+    parser.add_argument('--loops', type=int, dest='suite_loops', help="loops, for use with --suite")
+    parser.add_argument('--table-rows', type=int_list, default=[1000])
+    parser.add_argument('--table-columns', type=int_list, default=[2, 50])
+    parser.add_argument('--index-kinds', type=str_list, default=["integer", "string", "multi"])
+    parser.add_argument('--repeaters', type=int_list, default=[10, 25, 50])
+    parser.add_argument('--value-modes', type=str_list, default=["varbind", "native"])
+    args = parser.parse_args()
+    if args.suite:
+        if args.suite_loops:
+            args.loops = args.suite_loops
+        run_suite(args)
+        return
+    rows, loops = args.rows, args.loops
+    setup_oids(rows)
+    testagent.start_server()
+    try:
+        session = netsnmp.Session(Version=2, DestHost='localhost:1235', Community='public')
+        print("{:10s} {:>8s} {:>10s} {:>14s}".format("value_mode", "cells", "seconds", "cells/second"))
+        for value_mode in ("varbind", "native"):
+            rows, cells, seconds = measure(session, loops, max_repeaters=50, value_mode=value_mode)
+            print("{:10s} {:8d} {:10.4f} {:14.0f}".format(value_mode, cells, seconds, cells / seconds))
+        # The row cache decodes each instance OID suffix once per row instead of once per cell,
+        # as counted by the fetch statistics.
+        stats = row_cache_stats(session)
+        print("")
+        print("{:24s} {:>10s}".format("row cache", "count"))
+        print("{:24s} {:10d}".format("cells stored", stats['cells_stored']))
+        print("{:24s} {:10d}".format("index tuples decoded", stats['index_tuples']))
+        print("")
+        print("{:40s} {:14.0f}".format("other thread iterations/second in fetch",
+            background_progress(session, loops)))
+        print("")
+        print("{:10s} {:>8s} {:>10s} {:>14s}".format("replay", "cells", "seconds", "cells/second"))
+        for value_mode in ("varbind", "native"):
+            cells, seconds = replay_decode(session, loops, value_mode)
+            print("{:10s} {:8d} {:10.4f} {:14.0f}".format(value_mode, cells, seconds, cells / seconds))
+        print("")
+        print("{:24s} {:>10s} {:>12s}".format("table creation", "seconds", "max RSS kB"))
+        for label, (seconds, rss) in sorted(schema_startup(session).items()):
+            print("{:24s} {:10.4f} {:12d}".format(label, seconds, rss))
+    finally:
+        testagent.stop_server()
+
+if __name__ == '__main__':
+    main()
@@ -5,7 +5,9 @@ import netsnmp
 import netsnmptable
 import os
 import pprint
+import struct
 import sys
+import tempfile
 import testagent
 import time
 import thread
@@ -20,6 +22,12 @@ testagent.configure(agent_address = "localhost:1234",
 
 ascii_test_string = ' !"#$%&\'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~'
 
+COUNTER_TABLE_OID = ".1.3.6.1.4.99999.2.1"
+counterTableRows = []
+UPTIME_OID = ".1.3.6.1.4.99999.3"
+NAME_TABLE_OID = ".1.3.6.1.4.99999.4.1"
+uptimeScalar = []
+
 def setup_oids():
     singleIdxTable = testagent.Table(
         oidstr = "TEST-MIB::singleIdxTable",
@@ -88,10 +96,55 @@ def setup_oids():
     ipaddrIdxTableRow3.setRowCell(2, testagent.DisplayString("ContentOfRow3_Column1"))
     ipaddrIdxTableRow3.setRowCell(3, testagent.IpAddress("192.168.0.3"))
 
+    # not in TEST-MIB, queried with from_schema
+    counterTable = testagent.Table(
+        oidstr = COUNTER_TABLE_OID + ".1",
+        indexes = [
+            testagent.Integer32()
+        ],
+        columns = [
+            (2, testagent.Counter32(0)),
+            (3, testagent.Counter64(0))
+        ],
+    )
+    for i, (octets, packets) in enumerate([(4294967290, 100), (5, 7)]):
+        counterTableRows.append(counterTable.addRow([testagent.Integer32(i + 1)]))
+        counterTableRows[i].setRowCell(2, testagent.Counter32(octets))
+        counterTableRows[i].setRowCell(3, testagent.Counter64(packets))
+
+    # extends counterTable with the same index, rows need not exist in both tables
+    nameTable = testagent.Table(
+        oidstr = NAME_TABLE_OID + ".1",
+        indexes = [
+            testagent.Integer32()
+        ],
+        columns = [
+            (2, testagent.DisplayString(""))
+        ],
+    )
+    for i, name in [(1, "first"), (3, "third")]:
+        nameTable.addRow([testagent.Integer32(i)]).setRowCell(2, testagent.DisplayString(name))
+
+    # agent uptime as TimeTicks scalar, settable unlike sysUpTime
+    uptimeScalar.append(testagent.TimeTicks(4200, oidstr=UPTIME_OID))
+
 def varbind_to_repr(self):
     """Can be dynamically added to Varbind objects, for nice pprint output"""
     return self.type + ":" + self.val
 
+def truncate_capture(data, nr_of_responses):
+    """Keep the first nr_of_responses responses of a capture recorded by get_entries."""
+    def u32(pos):
+        return struct.unpack("!I", data[pos:pos + 4])[0]
+    pos = 8 # magic and version
+    for _ in range(nr_of_responses):
+        nr_of_vars = u32(pos + 8)
+        pos += 12
+        for _ in range(nr_of_vars):
+            pos += 4 + 4 * u32(pos) # OID
+            pos += 8 + u32(pos + 4) # type, value length and value
+    return data[:pos]
+
 class BasicTests(unittest.TestCase):
     @classmethod
     def setUpClass(cls):
@@ -181,6 +234,263 @@ class BasicTests(unittest.TestCase):
         self.assertEqual(tbldict[('ThisIsRow1', 2)].get('multiIdxTableEntryDesc').val, "ContentOfRow1.2_Column1")
         self.assertEqual(tbldict[('ThisIsRow1', 2)].get('multiIdxTableEntryValue').val, "2")
 
+    def test_singleIdxTable_native(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        tbldict = table.get_entries(value_mode="native")
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(len(tbldict), 4)
+        self.assertEqual(tbldict[('ThisIsRow1',)].get('singleIdxTableEntryDesc'), "ContentOfRow1_Column1 " + ascii_test_string)
+        self.assertEqual(tbldict[('ThisIsRow1',)].get('singleIdxTableEntryValue'), 1)
+        self.assertEqual(tbldict[('ThisIsRow3',)].get('singleIdxTableEntryValue'), 3)
+        self.assertEqual(tbldict[(ascii_test_string,)].get('singleIdxTableEntryValue'), 3)
+
+    def test_poller(self):
+        other_session = netsnmp.Session(Version=2, DestHost='localhost:1234', Community='public')
+        single_table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        multi_table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        poller = netsnmptable.Poller()
+        poller.add(self.netsnmp_session, single_table, key="single")
+        poller.add(self.netsnmp_session, multi_table, key="multi", max_repeaters=1)
+        poller.add(other_session, single_table, key="other", value_mode="native")
+        results = poller.run()
+        self.assertEqual(self.netsnmp_session.ErrorStr, "")
+        self.assertEqual(other_session.ErrorStr, "")
+        self.assertEqual(sorted(results.keys()), ["multi", "other", "single"])
+        self.assertEqual(len(results["single"]), 4)
+        self.assertEqual(len(results["multi"]), 4)
+        self.assertEqual(results["single"][('ThisIsRow2',)].get('singleIdxTableEntryValue').val, "2")
+        self.assertEqual(results["multi"][('ThisIsRow2', 1)].get('multiIdxTableEntryValue').val, "3")
+        self.assertEqual(results["other"][('ThisIsRow2',)].get('singleIdxTableEntryValue'), 2)
+
+    def test_multiIdxTable_columns(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        tbldict = table.get_entries(columns=['multiIdxTableEntryValue'])
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(len(tbldict), 4)
+        for row in tbldict.values():
+            self.assertEqual(list(row.keys()), ['multiIdxTableEntryValue'])
+        self.assertEqual(tbldict[('ThisIsRow2', 2)].get('multiIdxTableEntryValue').val, "4")
+        with self.assertRaises(ValueError):
+            table.get_entries(columns=['noSuchColumn'])
+
+    def test_singleIdxTable_striped(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        expected = table.get_entries()
+        tbldict = table.get_entries_striped(group_size=1)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(sorted(tbldict.keys()), sorted(expected.keys()))
+        for idx in expected:
+            self.assertEqual(sorted(tbldict[idx].keys()), sorted(expected[idx].keys()))
+            for col in expected[idx]:
+                self.assertEqual(tbldict[idx][col].val, expected[idx][col].val)
+        tbldict = table.get_entries_striped(max_repeaters=25, value_mode="native")
+        self.assertEqual(tbldict, table.get_entries(value_mode="native"))
+        # the default groups follow the column OIDs, and keep a minimum size at large max_repeaters
+        column_oids = dict(("c%d" % i, (1, 3, 6, 1, 2, 1, 2, 2, 1, i)) for i in range(1, 23))
+        columns = sorted(column_oids)
+        pack = netsnmptable.netsnmptable._pack_columns
+        self.assertEqual([len(g) for g in pack(columns, column_oids, (1472 - 60) // 2)], [22])
+        self.assertEqual([len(g) for g in pack(columns, column_oids, (1472 - 60) // 4)], [13, 9])
+        self.assertEqual([len(g) for g in pack(columns, column_oids, (1472 - 60) // 25)], [8, 8, 6])
+        self.assertEqual(sum(pack(columns, column_oids, 10), []), columns)
+
+    def test_multiIdxTable_v1(self):
+        expected = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable').get_entries()
+        session = netsnmp.Session(Version=1, DestHost='localhost:1234', Community='public')
+        table = session.table_from_mib('TEST-MIB::multiIdxTable')
+        for tbldict in (table.get_entries(), table.get_entries_striped()):
+            self.assertEqual(session.ErrorStr,
+                "",
+                msg="Error during SNMP request: %s" % session.ErrorStr
+                )
+            self.assertEqual(sorted(tbldict.keys()), sorted(expected.keys()))
+            self.assertEqual(tbldict[('ThisIsRow2', 2)].get('multiIdxTableEntryValue').val, "4")
+        # noSuchName at the end of a column is how SNMPv1 walks end, not a retry
+        table.get_entries(stats=True)
+        self.assertEqual(table.stats['retries'], 0)
+
+    def test_singleIdxTable_stats(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        tbldict = table.get_entries(max_repeaters=2, stats=True)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        stats = table.stats
+        self.assertGreaterEqual(stats['pdus_sent'], 2)
+        self.assertEqual(sum(count for bound, count in stats['rtt_histogram']), stats['pdus_sent'])
+        self.assertEqual(stats['varbinds_received'] - stats['varbinds_discarded'], 2 * len(tbldict))
+        self.assertGreater(stats['response_bytes'], stats['request_bytes'])
+        self.assertEqual(stats['too_big'], 0)
+        # one index decode per row, not per cell
+        self.assertEqual(stats['index_tuples'], len(tbldict))
+        self.assertEqual(stats['cells_stored'], 2 * len(tbldict))
+        table.get_entries()
+        self.assertIsNone(table.stats)
+
+    def test_singleIdxTable_adaptive(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        expected = table.get_entries()
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            tbldict = table.get_entries(max_repeaters=1, adaptive=True, stats=True, record=path)
+            self.assertEqual(self.netsnmp_session.ErrorStr,
+                "",
+                msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+                )
+            # full responses double max-repetitions, the third one reaches the end of the table
+            self.assertEqual(table.stats['max_repetitions'], [1, 2, 4])
+            self.assertEqual(table.stats['too_big'], 0)
+
+            # the agent answers the third request with tooBig, the same request goes again with half as many
+            with open(path, "rb") as f:
+                data = f.read()
+            head = truncate_capture(data, 2)
+            with open(path, "wb") as f:
+                f.write(head + struct.pack("!III", 1, 0, 0) + data[len(head):])
+            replayed = table.get_entries(max_repeaters=1, adaptive=True, stats=True, replay=path)
+        finally:
+            os.remove(path)
+        self.assertEqual(table.stats['max_repetitions'], [1, 2, 4, 2])
+        self.assertEqual(table.stats['too_big'], 1)
+        self.assertEqual(table.stats['retries'], 1)
+        for result in (tbldict, replayed):
+            self.assertEqual(sorted(result.keys()), sorted(expected.keys()))
+            for idx, row in expected.items():
+                for column, varbind in row.items():
+                    self.assertEqual(result[idx][column].val, varbind.val)
+
+    def test_singleIdxTable_iter(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        expected = table.get_entries()
+        rows = list(table.iter_entries(max_repeaters=1))
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual([idx for idx, row in rows],
+            [('ThisIsRow1',), ('ThisIsRow2',), ('ThisIsRow3',), (ascii_test_string,)])
+        for idx, row in rows:
+            self.assertEqual(sorted(row.keys()), sorted(expected[idx].keys()))
+            for column, varbind in row.items():
+                self.assertEqual(varbind.val, expected[idx][column].val)
+
+    def test_multiIdxTable_columnar(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        index, columns = table.get_entries(layout="columnar")
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(len(index), 4)
+        row1_1 = tuple([len("ThisIsRow1")] + [ord(c) for c in "ThisIsRow1"] + [1])
+        self.assertEqual(index[0], row1_1)
+        values = columns['multiIdxTableEntryValue']
+        self.assertEqual(values.kind, "int64")
+        self.assertEqual(list(struct.unpack("4q", buffer(values))), [1, 2, 3, 4])
+        descs = columns['multiIdxTableEntryDesc']
+        self.assertEqual(descs.kind, "bytes")
+        self.assertEqual(list(descs.valid), [1, 1, 1, 1])
+        self.assertEqual(descs[3], "ContentOfRow2.2_Column1")
+        self.assertEqual(str(buffer(descs))[descs.offsets[1]:descs.offsets[2]], "ContentOfRow1.2_Column1")
+
+    def test_singleIdxTable_resume(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            # one row per response, the walk stops after the second one as if the agent stopped answering
+            expected = table.get_entries(max_repeaters=1, record=path)
+            self.assertIsNone(table.cursor)
+            with open(path, "rb") as f:
+                data = f.read()
+            with open(path, "wb") as f:
+                f.write(truncate_capture(data, 2))
+            partial = table.get_entries(max_repeaters=1, replay=path)
+        finally:
+            os.remove(path)
+        self.assertEqual(sorted(partial.keys()), [('ThisIsRow1',), ('ThisIsRow2',)])
+        self.assertIsNotNone(table.cursor)
+
+        rest = table.get_entries(max_repeaters=1, resume=table.cursor, stats=True)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertIsNone(table.cursor)
+        self.assertEqual(sorted(rest.keys()), [('ThisIsRow3',), (ascii_test_string,)])
+        # the rows before the cursor are not requested again
+        self.assertEqual(table.stats['varbinds_received'] - table.stats['varbinds_discarded'], 2 * len(rest))
+        for idx in rest:
+            for column, varbind in rest[idx].items():
+                self.assertEqual(varbind.val, expected[idx][column].val)
+        with self.assertRaises(ValueError):
+            table.get_entries(resume=((1, 0, (1, 2, 3)),))
+
+    def test_multiIdxTable_range(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        tbldict = table.get_entries(iid=netsnmptable.str_to_varlen_iid("ThisIsRow1") + [2],
+            end_iid=netsnmptable.str_to_varlen_iid("ThisIsRow2") + [1])
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(sorted(tbldict.keys()), [('ThisIsRow1', 2), ('ThisIsRow2', 1)])
+        self.assertEqual(tbldict[('ThisIsRow2', 1)].get('multiIdxTableEntryValue').val, "3")
+
+    def test_multiIdxTable_partitioned(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        serial = table.get_entries()
+        tbldict = table.get_entries_partitioned([netsnmptable.str_to_varlen_iid("ThisIsRow2")], max_repeaters=1)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(sorted(tbldict.keys()), sorted(serial.keys()))
+        for idx in serial:
+            self.assertEqual(sorted(tbldict[idx].keys()), sorted(serial[idx].keys()))
+        self.assertEqual(netsnmptable.split_int_index(1, 40000, 4), [[10001], [20001], [30001]])
+
+    def test_multiIdxTable_get_rows(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        tbldict = table.get_rows([('ThisIsRow1', 2), ('ThisIsRow2', 1), ('NoSuchRow', 1)], max_varbinds=3)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(sorted(tbldict.keys()), [('ThisIsRow1', 2), ('ThisIsRow2', 1)])
+        self.assertEqual(tbldict[('ThisIsRow1', 2)].get('multiIdxTableEntryDesc').val, "ContentOfRow1.2_Column1")
+        self.assertEqual(tbldict[('ThisIsRow2', 1)].get('multiIdxTableEntryValue').val, "3")
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::ipaddrIdxTable')
+        tbldict = table.get_rows(['192.168.0.2'], columns=['ipaddrIdxTableEntryDesc'], value_mode="native")
+        self.assertEqual(tbldict, {'192.168.0.2': {'ipaddrIdxTableEntryDesc': "ContentOfRow2_Column1"}})
+        with self.assertRaises(ValueError):
+            table.get_rows([('192.168.0.2', 1)])
+
+    def test_counterTable_get_rows_uinteger(self):
+        table = self.netsnmp_session.table_from_schema(COUNTER_TABLE_OID,
+            columns={2: ("counterOctets", "COUNTER")}, indexes=["UINTEGER"])
+        expected = table.get_entries(value_mode="native")
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertTrue(expected)
+        # the keys get_entries returns are accepted by get_rows
+        self.assertEqual(table.get_rows(sorted(expected.keys()), value_mode="native"), expected)
+        with self.assertRaises(ValueError):
+            table.get_rows([-1])
+
     def test_ipAddrIdxTable(self):
         table = self.netsnmp_session.table_from_mib('TEST-MIB::ipaddrIdxTable')
         tbldict = table.get_entries()
@@ -202,6 +512,224 @@ class BasicTests(unittest.TestCase):
         self.assertEqual(tbldict[('192.168.0.3',)].get('ipaddrIdxTableEntryValue').val, '192.168.0.3')
         pprint.pprint(tbldict)
 
+    def test_multiIdxTable_schema_file(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        expected = table.get_entries()
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            table.save_schema(path)
+            cached = self.netsnmp_session.table_from_schema_file(path)
+        finally:
+            os.remove(path)
+        self.assertEqual(cached.columns, table.columns)
+        tbldict = cached.get_entries()
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(sorted(tbldict.keys()), sorted(expected.keys()))
+        for idx in expected:
+            for col in expected[idx]:
+                self.assertEqual(tbldict[idx][col].type, expected[idx][col].type)
+                self.assertEqual(tbldict[idx][col].val, expected[idx][col].val)
+
+    def test_counterTable_poll_rates(self):
+        table = self.netsnmp_session.table_from_schema(COUNTER_TABLE_OID,
+            columns={2: ("counterOctets", "COUNTER"), 3: ("counterPackets", "COUNTER64")},
+            indexes=["INTEGER"])
+        first = table.poll_rates(["counterOctets", "counterPackets"], uptime_oid=None)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(first, {(1,): {'counterOctets': None, 'counterPackets': None},
+                                 (2,): {'counterOctets': None, 'counterPackets': None}})
+        with testagent.ModuleVars.lock:
+            # Counter32 wraps around, the Counter64 of row 2 has a discontinuity
+            counterTableRows[0].setRowCell(2, testagent.Counter32(10))
+            counterTableRows[0].setRowCell(3, testagent.Counter64(150))
+            counterTableRows[1].setRowCell(3, testagent.Counter64(3))
+        try:
+            time.sleep(0.01)
+            second = table.poll_rates(["counterOctets", "counterPackets"], uptime_oid=None)
+            third = table.poll_rates(["counterOctets", "counterPackets"], uptime_oid=None)
+        finally:
+            with testagent.ModuleVars.lock:
+                counterTableRows[0].setRowCell(2, testagent.Counter32(4294967290))
+                counterTableRows[0].setRowCell(3, testagent.Counter64(100))
+                counterTableRows[1].setRowCell(3, testagent.Counter64(7))
+        self.assertEqual(second[(1,)]['counterOctets'][0], 16)
+        self.assertEqual(second[(1,)]['counterPackets'][0], 50)
+        self.assertGreater(second[(1,)]['counterPackets'][1], 0)
+        self.assertEqual(second[(2,)]['counterOctets'], (0, 0.0))
+        self.assertIsNone(second[(2,)]['counterPackets'])
+        self.assertEqual(third[(2,)]['counterPackets'], (0, 0.0))
+
+        # rates need the previous values kept in the Table, only poll_rates has them
+        with self.assertRaises(ValueError):
+            table.get_entries(value_mode="rate")
+        with self.assertRaises(ValueError):
+            table.get_rows([1], value_mode="rate")
+        with self.assertRaises(ValueError):
+            table.iter_entries(value_mode="rate")
+
+    def test_counterTable_poll_rates_restart(self):
+        table = self.netsnmp_session.table_from_schema(COUNTER_TABLE_OID,
+            columns={2: ("counterOctets", "COUNTER"), 3: ("counterPackets", "COUNTER64")},
+            indexes=["INTEGER"])
+        table.poll_rates(["counterOctets"], uptime_oid=UPTIME_OID + ".0")
+        self.assertEqual(table.scalar_values, {UPTIME_OID + ".0": 4200})
+        second = table.poll_rates(["counterOctets"], uptime_oid=UPTIME_OID + ".0")
+        self.assertEqual(second[(1,)]['counterOctets'], (0, 0.0))
+        with testagent.ModuleVars.lock:
+            uptimeScalar[0].update(100)
+        try:
+            # the agent restarted, previous values are meaningless
+            third = table.poll_rates(["counterOctets"], uptime_oid=UPTIME_OID + ".0")
+        finally:
+            with testagent.ModuleVars.lock:
+                uptimeScalar[0].update(4200)
+        self.assertEqual(third, {(1,): {'counterOctets': None}, (2,): {'counterOctets': None}})
+
+    def test_counterTable_group(self):
+        counters = self.netsnmp_session.table_from_schema(COUNTER_TABLE_OID,
+            columns={2: ("counterOctets", "COUNTER"), 3: ("counterPackets", "COUNTER64")},
+            indexes=["INTEGER"])
+        names = self.netsnmp_session.table_from_schema(NAME_TABLE_OID,
+            columns={2: ("counterName", "OCTETSTR")}, indexes=["INTEGER"])
+        expected = counters.get_entries(value_mode="native")
+        for idx, row in names.get_entries(value_mode="native").items():
+            expected.setdefault(idx, {}).update(row)
+
+        group = self.netsnmp_session.table_group([counters, names])
+        self.assertEqual(sorted(group.columns), ["counterName", "counterOctets", "counterPackets"])
+        tbldict = group.get_entries(value_mode="native", max_repeaters=1)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(tbldict, expected)
+        self.assertEqual(group.get_entries(value_mode="native", columns=["counterName"]),
+                         {(1,): {'counterName': 'first'}, (3,): {'counterName': 'third'}})
+        self.assertEqual(dict(group.iter_entries(value_mode="native")), expected)
+
+        single = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        # counters has no MIB name, the message names it by OID
+        with self.assertRaisesRegexp(ValueError, r"^\.1\.3\.6\.1\.4\.99999\.2\.1 and .*singleIdxTable have different indexes$"):
+            self.netsnmp_session.table_group([counters, single])
+        with self.assertRaisesRegexp(ValueError, "different indexes"):
+            self.netsnmp_session.table_group([single, names])
+
+    def test_counterTable_get_changes(self):
+        table = self.netsnmp_session.table_from_schema(COUNTER_TABLE_OID,
+            columns={2: ("counterOctets", "COUNTER"), 3: ("counterPackets", "COUNTER64")},
+            indexes=["INTEGER"])
+        added, changed, removed = table.get_changes(max_repeaters=1)
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(added, table.get_entries(value_mode="native"))
+        self.assertEqual((changed, removed), ({}, []))
+        self.assertEqual(table.get_changes(max_repeaters=1), ({}, {}, []))
+
+        with testagent.ModuleVars.lock:
+            counterTableRows[1].setRowCell(3, testagent.Counter64(8))
+        try:
+            added, changed, removed = table.get_changes(max_repeaters=1)
+        finally:
+            with testagent.ModuleVars.lock:
+                counterTableRows[1].setRowCell(3, testagent.Counter64(7))
+        self.assertEqual((added, removed), ({}, []))
+        self.assertEqual(changed, {(2,): {'counterOctets': 5, 'counterPackets': 8}})
+
+        # a narrower range leaves row 2 out, so it looks removed
+        self.assertEqual(table.get_changes(iid=[1], end_iid=[1]), ({}, {}, [(2,)]))
+
+    def test_singleIdxTable_scalars(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        expected = table.get_entries(value_mode="native")
+        missing = UPTIME_OID + ".7.0"
+        tbldict = table.get_entries(value_mode="native", max_repeaters=2,
+                                    scalars=[UPTIME_OID + ".0", missing])
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(tbldict, expected)
+        self.assertEqual(table.scalar_values, {UPTIME_OID + ".0": 4200, missing: None})
+        table.get_entries()
+        self.assertIsNone(table.scalar_values)
+
+    def test_singleIdxTable_where(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTable')
+        expected = table.get_entries(value_mode="native")
+        value = netsnmptable.Column("singleIdxTableEntryValue")
+        desc = netsnmptable.Column("singleIdxTableEntryDesc")
+        tbldict = table.get_entries(value_mode="native", max_repeaters=1, columns=["singleIdxTableEntryDesc"],
+                                    where=(value >= 2) & ~desc.startswith("ContentOfRow3"))
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        # the filter column is fetched, but the rows only contain the column asked for
+        self.assertEqual(tbldict, dict((idx, {"singleIdxTableEntryDesc": expected[idx]["singleIdxTableEntryDesc"]})
+                                       for idx in [('ThisIsRow2',), (ascii_test_string,)]))
+        rows = list(table.iter_entries(max_repeaters=1, where=value.isin([1, 3]) | (desc == "none")))
+        self.assertEqual([idx for idx, row in rows], [('ThisIsRow1',), ('ThisIsRow3',), (ascii_test_string,)])
+        # a string never equals an INTEGER cell
+        self.assertEqual(table.get_entries(where=value == "1"), {})
+        self.assertRaises(ValueError, table.get_entries, where=netsnmptable.Column("noSuchColumn") == 1)
+        self.assertRaises(ValueError, table.get_entries, layout="columnar", where=value == 1)
+        self.assertEqual(table.get_entries(value_mode="native"), expected)
+
+    def test_multiIdxTable_record_replay(self):
+        table = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable')
+        fd, path = tempfile.mkstemp()
+        os.close(fd)
+        try:
+            expected = table.get_entries(max_repeaters=2, record=path)
+            # nothing listens on this port, responses can only come from the capture
+            offline = netsnmp.Session(Version=2, DestHost='localhost:1', Community='public', Retries=0)
+            replayed = offline.table_from_mib('TEST-MIB::multiIdxTable')
+            tbldict = replayed.get_entries(max_repeaters=2, replay=path, stats=True)
+        finally:
+            os.remove(path)
+        self.assertEqual(offline.ErrorStr,
+            "",
+            msg="Error during replay: %s" % offline.ErrorStr
+            )
+        self.assertEqual(sum(count for bound, count in replayed.stats['rtt_histogram']),
+                         replayed.stats['pdus_sent'])
+        self.assertEqual(replayed.stats['rtt_histogram'][0][1], replayed.stats['pdus_sent'])
+        self.assertEqual(sorted(tbldict.keys()), sorted(expected.keys()))
+        for idx in expected:
+            for col in expected[idx]:
+                self.assertEqual(tbldict[idx][col].type, expected[idx][col].type)
+                self.assertEqual(tbldict[idx][col].val, expected[idx][col].val)
+
+    def test_multiIdxTable_from_schema(self):
+        expected = self.netsnmp_session.table_from_mib('TEST-MIB::multiIdxTable').get_entries()
+        table = self.netsnmp_session.table_from_schema(".1.3.6.1.4.99999.1.1.2",
+            columns={3: ("multiIdxTableEntryDesc", "OCTETSTR"), 4: ("multiIdxTableEntryValue", "INTEGER32")},
+            indexes=["OCTETSTR", "INTEGER32"])
+        tbldict = table.get_entries()
+        self.assertEqual(self.netsnmp_session.ErrorStr,
+            "",
+            msg="Error during SNMP request: %s" % self.netsnmp_session.ErrorStr
+            )
+        self.assertEqual(sorted(tbldict.keys()), sorted(expected.keys()))
+        for idx in expected:
+            for col in expected[idx]:
+                self.assertEqual(tbldict[idx][col].type, expected[idx][col].type)
+                self.assertEqual(tbldict[idx][col].val, expected[idx][col].val)
+        with self.assertRaises(ValueError):
+            self.netsnmp_session.table_from_schema(".1.3.6.1.4.99999.1.1.2", {3: ("desc", "NOSUCHSYNTAX")}, [])
+        # messages name the table by OID
+        with self.assertRaisesRegexp(ValueError, r"\.1\.3\.6\.1\.4\.99999\.1\.1\.2$"):
+            table.get_entries(columns=["noSuchColumn"])
+
     def test_create_from_badOid(self):
         with self.assertRaises(RuntimeError):
             self.netsnmp_session.table_from_mib('TEST-MIB::singleIdxTableEntry')